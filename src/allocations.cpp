@@ -0,0 +1,25 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "allocations.hpp"
+
+using namespace std;
+
+namespace {
+	atomic<size_t> allocations = 0;
+}
+
+size_t KSP::allocationCount() {
+	return allocations.load(memory_order_relaxed);
+}
+
+// the array and nothrow forms all end up in here
+void* operator new(size_t size) {
+	allocations.fetch_add(1, memory_order_relaxed);
+	if (void* p = malloc(size ? size : 1)) return p;
+	throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
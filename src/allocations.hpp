@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstddef>
+
+// Every operator new in a program that links allocations.o goes through a counter, for the
+// benchmarks and for checking that a solve path really stays off the heap. Linking it in is
+// the whole switch: rock itself doesn't, and pays nothing for it.
+namespace KSP {
+	size_t allocationCount(); // since the program started, across every thread
+};
@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+#include "ascent.hpp"
+
+using namespace std;
+using namespace KSP;
+
+namespace {
+	// the integrated state, a column each: x, y, vx, vy, mass, then the three integrals
+	enum Column { X, Y, VX, VY, Mass, DeltaV, GravityLoss, DragLoss, Columns };
+
+	constexpr double g0 = 9.81;
+
+	struct Integrator {
+		const Body& body;
+		const AltitudeTable& table;
+		const AscentOptions& options;
+		const AscentBatch& batch;
+		size_t n;
+
+		// the derivative of every lane's `state` into `out`
+		void derive(const double* state, double* out) {
+			const double* x = state + X * n;
+			const double* y = state + Y * n;
+			const double* vx = state + VX * n;
+			const double* vy = state + VY * n;
+			const double* mass = state + Mass * n;
+			const double turnLength = max(options.turnEnd - options.turnStart, 1.0);
+			const double dragScale = 0.5 * options.dragArea / 1000.0; // N to kN, which over tonnes is m/s^2
+			const size_t samples = table.samples();
+			const double* densities = table.density().data();
+			const double* isps = table.isp().data();
+			const double* thrusts = table.thrust().data();
+
+			for (size_t i = 0; i < n; i++) {
+				const double r = sqrt(x[i] * x[i] + y[i] * y[i]);
+				const double upX = x[i] / r, upY = y[i] / r;
+				const double eastX = upY, eastY = -upX;
+
+				// the air and the engine at this height, between the two samples it falls in
+				size_t k;
+				double f;
+				table.locate(r - body.radius, k, f);
+				const size_t row = batch.engine[i] * samples + k;
+				const double density = densities[k] + f * (densities[k + 1] - densities[k]);
+				const double thrust = batch.engines[i] * (thrusts[row] + f * (thrusts[row + 1] - thrusts[row]));
+				const double isp = isps[row] + f * (isps[row + 1] - isps[row]);
+
+				// straight up, then leaning east with the square root of how far into the turn it is
+				const double lean = sqrt(clamp((r - body.radius - options.turnStart) / turnLength, 0.0, 1.0));
+				const double headingX = (1.0 - lean) * upX + lean * eastX, headingY = (1.0 - lean) * upY + lean * eastY;
+				const double headingLength = sqrt(headingX * headingX + headingY * headingY);
+
+				const double speed = sqrt(vx[i] * vx[i] + vy[i] * vy[i]);
+				const double m = max(mass[i], 1e-6); // a lane with nothing in it still has to stay a number
+				const double push = thrust / m;
+				const double drag = dragScale * density * speed / m; // times velocity
+				const double gravity = body.gravity * body.radius * body.radius / (r * r);
+
+				out[X * n + i] = vx[i];
+				out[Y * n + i] = vy[i];
+				out[VX * n + i] = push * headingX / headingLength - gravity * upX - drag * vx[i];
+				out[VY * n + i] = push * headingY / headingLength - gravity * upY - drag * vy[i];
+				out[Mass * n + i] = -thrust / (isp * g0);
+
+				out[DeltaV * n + i] = push;
+				out[GravityLoss * n + i] = gravity * (vx[i] * upX + vy[i] * upY + 1e-3) / (speed + 1e-3); // straight up while at rest
+				out[DragLoss * n + i] = drag * speed;
+			}
+		}
+	};
+};
+
+void KSP::AscentBatch::resize(size_t lanes) {
+	for (auto* column : { &x, &y, &vx, &vy, &mass, &dryMass, &engines, &deltaV, &gravityLoss, &dragLoss, &time })
+		column->resize(lanes);
+	engine.resize(lanes);
+	crashed.resize(lanes);
+}
+
+void KSP::AscentBatch::launch(const Body& body) {
+	fill(x.begin(), x.end(), 0.0);
+	fill(y.begin(), y.end(), body.radius);
+	for (auto* column : { &vx, &vy, &deltaV, &gravityLoss, &dragLoss, &time })
+		fill(column->begin(), column->end(), 0.0);
+	fill(crashed.begin(), crashed.end(), 0);
+}
+
+void KSP::fly(const Body& body, const AltitudeTable& table, const AscentOptions& options, AscentBatch& batch) {
+	const size_t n = batch.size();
+	if (n == 0 || table.isp().empty()) return; // no engines, nothing to burn
+
+	Integrator integrator{ body, table, options, batch, n };
+
+	vector<double*> columns = { batch.x.data(), batch.y.data(), batch.vx.data(), batch.vy.data(), batch.mass.data(),
+		batch.deltaV.data(), batch.gravityLoss.data(), batch.dragLoss.data() };
+
+	vector<double> state(Columns * n), slope(Columns * n), sum(Columns * n), probe(Columns * n), step(n), elapsed(n);
+	for (int c = 0; c < Columns; c++) copy(columns[c], columns[c] + n, state.begin() + c * n);
+
+	// every lane moves by its own step, 0 once it's done, so lanes never need to be taken out
+	auto advance = [&](double* out, const double* from, double fraction, const double* by) {
+		for (int c = 0; c < Columns; c++)
+			for (size_t i = 0; i < n; i++) out[c * n + i] = from[c * n + i] + fraction * step[i] * by[c * n + i];
+	};
+
+	while (true) {
+		integrator.derive(state.data(), slope.data());
+
+		// the step that ends the burn is cut to end right at burnout, with the flow rate at its start
+		bool any = false;
+		for (size_t i = 0; i < n; i++) {
+			const double fuel = state[Mass * n + i] - batch.dryMass[i];
+			const double flow = -slope[Mass * n + i];
+			const bool burning = !batch.crashed[i] && fuel > 1e-9 * batch.dryMass[i] && flow > 0.0 && elapsed[i] < options.maxTime;
+
+			step[i] = burning ? min(options.step, fuel / flow) : 0.0;
+			any |= burning;
+		}
+		if (!any) break;
+
+		// classic RK4, the four slopes summed with weights 1, 2, 2, 1
+		sum = slope;
+		advance(probe.data(), state.data(), 0.5, slope.data());
+		integrator.derive(probe.data(), slope.data());
+		for (size_t j = 0; j < sum.size(); j++) sum[j] += 2.0 * slope[j];
+
+		advance(probe.data(), state.data(), 0.5, slope.data());
+		integrator.derive(probe.data(), slope.data());
+		for (size_t j = 0; j < sum.size(); j++) sum[j] += 2.0 * slope[j];
+
+		advance(probe.data(), state.data(), 1.0, slope.data());
+		integrator.derive(probe.data(), slope.data());
+		for (size_t j = 0; j < sum.size(); j++) sum[j] += slope[j];
+
+		advance(state.data(), state.data(), 1.0 / 6.0, sum.data());
+
+		for (size_t i = 0; i < n; i++) {
+			state[Mass * n + i] = max(state[Mass * n + i], batch.dryMass[i]);
+			batch.time[i] += step[i];
+			elapsed[i] += step[i];
+
+			const double x = state[X * n + i], y = state[Y * n + i];
+			if (step[i] > 0.0 && sqrt(x * x + y * y) < body.radius) batch.crashed[i] = 1;
+		}
+	}
+
+	for (int c = 0; c < Columns; c++) copy(state.begin() + c * n, state.begin() + (c + 1) * n, columns[c]);
+}
+
+vector<AscentScore> KSP::scoreAscents(const Body& body, const AltitudeTable& table, const EngineTable& engines,
+	span<const Tank> tanks, const MultiArgs& args, span<const vector<Stage>> rockets, const AscentOptions& options) {
+	unordered_map<string_view, uint32_t> rows;
+	for (size_t i = 0; i < engines.size(); i++) rows.emplace(engines.names[i], (uint32_t)i);
+
+	size_t stages = 0;
+	for (const auto& rocket : rockets) stages = max(stages, rocket.size());
+
+	AscentBatch batch;
+	batch.resize(rockets.size());
+	batch.launch(body);
+
+	// bottom stages first, every rocket's k-th from the bottom in the same flight
+	for (size_t k = 0; k < stages; k++) {
+		for (size_t i = 0; i < rockets.size(); i++) {
+			const vector<Stage>& rocket = rockets[i];
+
+			// nothing left to burn: the lane just keeps where it got to
+			batch.dryMass[i] = batch.mass[i];
+			batch.engine[i] = 0;
+			batch.engines[i] = 0.0;
+			if (k >= rocket.size() || !rocket[rocket.size() - 1 - k].feasible()) continue;
+
+			// an engine the table doesn't have can't be flown either
+			const Stage& stage = rocket[rocket.size() - 1 - k];
+			const auto row = rows.find(stage.engine.name);
+			if (row == rows.end()) continue;
+
+			// real tanks hold what they hold, otherwise whatever isn't engines or the decoupler is
+			// tanks, full, at the engine's ratio
+			double fuel = 0.0;
+			if (!stage.tanks.empty()) {
+				bool known = true;
+				for (const auto& [tank, count] : stage.tanks) {
+					known = known && tank >= 0 && (size_t)tank < tanks.size();
+					if (known) fuel += count * tanks[tank].fuel();
+				}
+				if (!known) continue;
+			}
+			else {
+				const double above = k + 1 < rocket.size() ? rocket[rocket.size() - 2 - k].mass : args.payload;
+				const double own = stage.mass - above;
+				fuel = max(own - stage.count * stage.engine.mass - args.decouplerMass, 0.0) / (1.0 + engines.tankRatio[row->second]);
+			}
+
+			batch.mass[i] = stage.mass;
+			batch.dryMass[i] = stage.mass - fuel;
+			batch.engine[i] = row->second;
+			batch.engines[i] = stage.count;
+		}
+
+		fly(body, table, options, batch);
+	}
+
+	vector<AscentScore> scores(rockets.size());
+	for (size_t i = 0; i < rockets.size(); i++) {
+		const double r = sqrt(batch.x[i] * batch.x[i] + batch.y[i] * batch.y[i]);
+
+		AscentScore& score = scores[i];
+		score.deltaV = batch.deltaV[i];
+		score.gravityLoss = batch.gravityLoss[i];
+		score.dragLoss = batch.dragLoss[i];
+		score.altitude = r - body.radius;
+		score.speed = sqrt(batch.vx[i] * batch.vx[i] + batch.vy[i] * batch.vy[i]);
+		score.horizontalSpeed = (batch.vx[i] * batch.y[i] - batch.vy[i] * batch.x[i]) / r;
+		score.crashed = batch.crashed[i];
+	}
+
+	return scores;
+}
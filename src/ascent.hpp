@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "bodies.hpp"
+#include "ksp.hpp"
+#include "parts.hpp"
+#include "solver.hpp"
+
+using namespace std;
+
+namespace KSP {
+	// How the simulated rockets fly: straight up to `turnStart`, then leaning over until they
+	// fly level at `turnEnd`.
+	struct AscentOptions {
+		double turnStart = 1000.0; // m
+		double turnEnd = 45000.0; // m
+
+		double dragArea = 1.5; // drag coefficient times cross section of the whole stack, m^2
+
+		double step = 0.5; // s, the last step of a burn is cut short to end right at burnout
+		double maxTime = 1200.0; // s per stage, for stages that hover rather than climb
+	};
+
+	// Many stages burning side by side, a lane each, kept column by column so every integrator
+	// step is a handful of straight loops over doubles that the compiler vectorizes. Fill in a
+	// lane's state and stage, fly() it, and the state and integrals carry on into the next stage.
+	struct AscentBatch {
+		// a 2D point mass, from the body's centre with the launch site straight up the y axis
+		vector<double> x, y, vx, vy; // m, m/s
+		vector<double> mass; // t
+
+		// the stage burning: until `dryMass` is left, `engines` of the AltitudeTable's row `engine`
+		vector<double> dryMass; // t
+		vector<uint32_t> engine;
+		vector<double> engines; // 0 to coast
+
+		// integrals over the whole flight so far, m/s
+		vector<double> deltaV; // thrust over mass
+		vector<double> gravityLoss; // gravity along the flight path
+		vector<double> dragLoss;
+
+		vector<double> time; // s
+		vector<uint8_t> crashed; // never got off the ground, or fell back into it
+
+		void resize(size_t lanes);
+		void launch(const Body& body); // every lane on the launch site at rest, integrals cleared
+		size_t size() const { return mass.size(); }
+	};
+
+	// RK4 over every lane at once until each one burns out, crashes or runs out of time, with
+	// the air and the engines in it read off `table`, which has to be the one for `body`.
+	void fly(const Body& body, const AltitudeTable& table, const AscentOptions& options, AscentBatch& batch);
+
+	struct AscentScore {
+		double deltaV = 0.0; // what the engines gave, at the pressures they actually burned in
+		double gravityLoss = 0.0;
+		double dragLoss = 0.0;
+
+		double altitude = 0.0; // m, at the last burnout
+		double speed = 0.0; // m/s
+		double horizontalSpeed = 0.0; // m/s
+
+		bool crashed = false;
+	};
+
+	// Flies finished rockets (top stage first, as every solver returns them) off `body`, all in
+	// one batch, stage after stage from the bottom. A stage built from real tanks burns what
+	// those of `tanks` hold, the PartCatalog::tanks it was solved with. Any other stage's fuel is
+	// worked out from its mass, engines and the tank ratio `engines` has for its engine, so
+	// `args` has to be the mission they were solved for, and `table` built for `body` from the
+	// same `engines`.
+	vector<AscentScore> scoreAscents(const Body& body, const AltitudeTable& table, const EngineTable& engines,
+		span<const Tank> tanks, const MultiArgs& args, span<const vector<Stage>> rockets, const AscentOptions& options = {});
+};
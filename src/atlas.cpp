@@ -0,0 +1,379 @@
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <fcntl.h>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <nlohmann/json.hpp>
+
+#include "atlas.hpp"
+#include "datfile.hpp"
+#include "parallel.hpp"
+#include "bodies.hpp"
+
+using json = nlohmann::json;
+
+using namespace std;
+using namespace KSP;
+
+namespace {
+	constexpr char magic[8] = { 'R', 'O', 'C', 'K', 'A', 'T', 'L', '\0' };
+	constexpr uint32_t version = 2;
+	constexpr size_t headerSize = 88;
+
+	size_t nodeSize(uint32_t stages) { return 8 + 4 * (size_t)stages; }
+
+	void put16(char* out, uint16_t value) {
+		out[0] = (char)value;
+		out[1] = (char)(value >> 8);
+	}
+
+	uint16_t get16(const char* in) { return (uint16_t)((uint8_t)in[0] | (uint8_t)in[1] << 8); }
+
+	// bilinear in log mass, infinite when any corner is
+	double blend(double m00, double m01, double m10, double m11, double u, double v) {
+		if (!isfinite(m00) || !isfinite(m01) || !isfinite(m10) || !isfinite(m11)) return INFINITY;
+
+		const double low = lerp(log(m00), log(m01), v);
+		const double high = lerp(log(m10), log(m11), v);
+		return exp(lerp(low, high, u));
+	}
+
+	// where grid `position` falls between grid lines `i` and `i + 1`, `fraction` of the way along
+	void locate(double position, uint32_t steps, uint32_t& i, double& fraction) {
+		position = clamp(position, 0.0, (double)(steps - 1));
+		i = min((uint32_t)position, steps - 2);
+		fraction = position - i;
+	}
+};
+
+bool KSP::buildAtlas(const string& path, const Catalog& catalog, const AtlasSpec& spec, int threads) {
+	const uint32_t stages = spec.maxStages;
+	if (spec.payloads < 2 || spec.deltaVs < 2 || stages < 1 || spec.atm.size() < stages || spec.twr.size() < stages) return false;
+	if (!(spec.minPayload > 0.0 && spec.minPayload < spec.maxPayload && spec.minDeltaV < spec.maxDeltaV)) return false;
+	if (catalog.engines.size() > UINT16_MAX) return false;
+
+	auto payloadAt = [&](double i) { return spec.minPayload * pow(spec.maxPayload / spec.minPayload, i / (spec.payloads - 1)); };
+	auto deltaVAt = [&](double j) { return lerp(spec.minDeltaV, spec.maxDeltaV, j / (spec.deltaVs - 1)); };
+
+	// names of the planets and engines, and where each engine's row ended up
+	string strings;
+	vector<pair<size_t, size_t>> planetNames, engineNames;
+	for (const Body& body : bodies) {
+		planetNames.emplace_back(strings.size(), string_view(body.name).size());
+		strings += body.name;
+	}
+
+	unordered_map<string_view, uint16_t> rows;
+	for (size_t i = 0; i < catalog.engines.size(); i++) {
+		engineNames.emplace_back(strings.size(), catalog.engines.names[i].size());
+		strings += catalog.engines.names[i];
+		rows.emplace(catalog.engines.names[i], (uint16_t)i);
+	}
+
+	string out(headerSize, '\0');
+	memcpy(out.data(), magic, sizeof(magic));
+	Dat::put32(&out[8], version);
+	Dat::put32(&out[12], headerSize);
+	Dat::putU64(&out[16], catalog.hash);
+	Dat::put32(&out[24], size(bodies));
+	Dat::put32(&out[28], stages);
+	Dat::put32(&out[32], spec.payloads);
+	Dat::put32(&out[36], spec.deltaVs);
+	Dat::put32(&out[40], catalog.engines.size());
+	Dat::put32(&out[44], strings.size());
+	Dat::put64(&out[48], spec.minPayload);
+	Dat::put64(&out[56], spec.maxPayload);
+	Dat::put64(&out[64], spec.minDeltaV);
+	Dat::put64(&out[72], spec.maxDeltaV);
+	Dat::put32(&out[80], spec.maxEngines);
+
+	for (size_t p = 0; p < size(bodies); p++) {
+		Dat::append32(out, planetNames[p].first);
+		Dat::append32(out, planetNames[p].second);
+		Dat::append64(out, bodies[p].gravity);
+	}
+	for (uint32_t s = 0; s < stages; s++) Dat::append64(out, spec.atm[s]);
+	for (uint32_t s = 0; s < stages; s++) Dat::append64(out, spec.twr[s]);
+	for (const auto& [offset, length] : engineNames) {
+		Dat::append32(out, offset);
+		Dat::append32(out, length);
+	}
+
+	// shared by the whole atlas, neighbouring nodes keep asking for the same stages
+	StageCache cache(1 << 18);
+	vector<SolveArena> arenas(max(threads, 1));
+
+	const size_t nodes = (size_t)spec.payloads * spec.deltaVs;
+	const auto start = chrono::steady_clock::now();
+
+	for (size_t p = 0; p < size(bodies); p++) {
+		for (uint32_t n = 1; n <= stages; n++) {
+			const MultiArgs mission{ 0.0, 0.0, bodies[p].gravity, (int)n,
+				vector<double>(spec.atm.begin(), spec.atm.begin() + n), vector<double>(spec.twr.begin(), spec.twr.begin() + n), spec.maxEngines };
+
+			auto solve = [&](double payload, double deltaV, int worker) {
+				MultiArgs args = mission;
+				args.payload = payload;
+				args.deltaV = deltaV;
+
+				const SolveContext context{ catalog.engines, 1, nullptr, &cache, nullptr, &arenas[worker] };
+				return solveMission(context, args, spec.solver);
+			};
+			auto massOf = [](const vector<Stage>& rocket) {
+				return !rocket.empty() && rocket.back().feasible() ? rocket.back().mass : INFINITY;
+			};
+
+			string sheet(8 + nodes * nodeSize(n), '\0');
+			parallelFor(nodes, threads, [&](size_t k, int worker) {
+				const vector<Stage> rocket = solve(payloadAt(k / spec.deltaVs), deltaVAt(k % spec.deltaVs), worker);
+				char* node = &sheet[8 + k * nodeSize(n)];
+
+				Dat::put32(node, bit_cast<uint32_t>((float)massOf(rocket)));
+				if (!isfinite(massOf(rocket)) || rocket.size() != n) return;
+				for (uint32_t s = 0; s < n; s++) {
+					const auto row = rows.find(rocket[s].engine.name);
+					put16(node + 8 + 4 * s, row == rows.end() ? 0 : row->second);
+					put16(node + 10 + 4 * s, rocket[s].count);
+				}
+			}, 1);
+
+			// every cell's centre solved too, against what a lookup would say there; kept with the
+			// cell's first node
+			auto node = [&](size_t i, size_t j) { return &sheet[8 + (i * spec.deltaVs + j) * nodeSize(n)]; };
+			auto nodeMass = [&](size_t i, size_t j) { return (double)bit_cast<float>(Dat::get32(node(i, j))); };
+
+			const size_t cells = (size_t)(spec.payloads - 1) * (spec.deltaVs - 1);
+			vector<double> errors(cells, 0.0);
+			parallelFor(cells, threads, [&](size_t k, int worker) {
+				const size_t i = k / (spec.deltaVs - 1), j = k % (spec.deltaVs - 1);
+				const double guess = blend(nodeMass(i, j), nodeMass(i, j + 1), nodeMass(i + 1, j), nodeMass(i + 1, j + 1), 0.5, 0.5);
+				const double exact = massOf(solve(payloadAt(i + 0.5), deltaVAt(j + 0.5), worker));
+				if (isfinite(guess) && isfinite(exact)) errors[k] = abs(guess - exact) / exact;
+
+				Dat::put32(node(i, j) + 4, bit_cast<uint32_t>((float)errors[k]));
+			}, 1);
+
+			const double error = *max_element(errors.begin(), errors.end());
+			Dat::put64(sheet.data(), error);
+			out += sheet;
+
+			const double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+			fprintf(stderr, "%s, %u stage%s: %zu nodes, worst error at a cell centre %.2f%% (%.1f s)\n", bodies[p].name, n, n == 1 ? "" : "s", nodes, 100.0 * error, elapsed);
+		}
+	}
+
+	out += strings;
+	return Dat::writeFile(path, vector<char>(out.begin(), out.end()));
+}
+
+// Atlas
+
+KSP::Atlas::Atlas(const string& path) {
+	const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0) return;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || (size_t)info.st_size < headerSize) {
+		close(fd);
+		return;
+	}
+
+	void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd); // the mapping keeps the file alive
+	if (mapping == MAP_FAILED) return;
+
+	const char* file = (const char*)mapping;
+	const size_t size = info.st_size;
+	auto fail = [&] { munmap(mapping, size); };
+
+	if (memcmp(file, magic, sizeof(magic)) != 0 || Dat::get32(file + 8) != version || Dat::get32(file + 12) < headerSize) {
+		fail();
+		return;
+	}
+
+	catalogHash = Dat::getU64(file + 16);
+	planetCount = Dat::get32(file + 24);
+	stageCount = Dat::get32(file + 28);
+	payloads = Dat::get32(file + 32);
+	deltaVs = Dat::get32(file + 36);
+	engineCount = Dat::get32(file + 40);
+	stringsSize = Dat::get32(file + 44);
+	minPayload = Dat::get64(file + 48);
+	maxPayload = Dat::get64(file + 56);
+	minDeltaV = Dat::get64(file + 64);
+	maxDeltaV = Dat::get64(file + 72);
+	maxEngines = (int)Dat::get32(file + 80);
+
+	const size_t nodes = (size_t)payloads * deltaVs;
+	if (payloads < 2 || deltaVs < 2 || stageCount < 1 || stageCount > UINT16_MAX || nodes > size || !(minPayload > 0.0)) {
+		fail();
+		return;
+	}
+
+	// every count is 32 bits and the sheets are added up one at a time against the real size,
+	// so none of this can overflow
+	size_t offset = Dat::get32(file + 12);
+	planetTable = file + offset;
+	offset += 16 * planetCount + 16 * stageCount;
+	engineTable = file + offset;
+	offset += 8 * engineCount;
+
+	for (size_t p = 0; p < planetCount && offset <= size; p++) {
+		for (uint32_t n = 1; n <= stageCount && offset <= size; n++) {
+			sheets.push_back(offset);
+			offset += 8 + nodes * nodeSize(n);
+		}
+	}
+
+	if (sheets.size() != planetCount * stageCount || offset > size || offset + stringsSize != size) {
+		sheets.clear();
+		fail();
+		return;
+	}
+
+	strings = file + offset;
+	data = file;
+	bytes = size;
+}
+
+KSP::Atlas::~Atlas() {
+	if (data) munmap((void*)data, bytes);
+}
+
+string_view KSP::Atlas::text(const char* ref) const {
+	const size_t offset = Dat::get32(ref);
+	const size_t length = Dat::get32(ref + 4);
+	if (offset + length > stringsSize) return {};
+
+	return string_view(strings + offset, length);
+}
+
+int KSP::Atlas::planet(string_view name) const {
+	if (!data) return -1;
+
+	for (size_t p = 0; p < planetCount; p++)
+		if (text(planetTable + 16 * p) == name) return (int)p;
+
+	return -1;
+}
+
+const char* KSP::Atlas::sheet(int planet, uint32_t stages) const {
+	return data + sheets[planet * stageCount + stages - 1];
+}
+
+AtlasPoint KSP::Atlas::lookup(int planet, uint32_t stages, double payload, double deltaV) const {
+	AtlasPoint point;
+	if (!data || planet < 0 || (size_t)planet >= planetCount || stages < 1 || stages > stageCount) return point;
+
+	// nothing was solved out there, so nothing can be interpolated or rounded to
+	if (!(payload >= minPayload && payload <= maxPayload && deltaV >= minDeltaV && deltaV <= maxDeltaV)) return point;
+	point.inGrid = true;
+
+	uint32_t i, j;
+	double u, v;
+	locate(log(max(payload, 1e-300) / minPayload) / log(maxPayload / minPayload) * (payloads - 1), payloads, i, u);
+	locate((deltaV - minDeltaV) / (maxDeltaV - minDeltaV) * (deltaVs - 1), deltaVs, j, v);
+
+	const char* nodes = sheet(planet, stages);
+	auto node = [&](uint32_t a, uint32_t b) { return nodes + 8 + ((size_t)a * deltaVs + b) * nodeSize(stages); };
+	auto mass = [&](uint32_t a, uint32_t b) { return (double)bit_cast<float>(Dat::get32(node(a, b))); };
+
+	const uint32_t nearI = i + (u >= 0.5), nearJ = j + (v >= 0.5);
+	point.nodePayload = minPayload * pow(maxPayload / minPayload, (double)nearI / (payloads - 1));
+	point.nodeDeltaV = lerp(minDeltaV, maxDeltaV, (double)nearJ / (deltaVs - 1));
+
+	const double nearest = mass(nearI, nearJ);
+	point.error = bit_cast<float>(Dat::get32(node(i, j) + 4));
+	const double blended = blend(mass(i, j), mass(i, j + 1), mass(i + 1, j), mass(i + 1, j + 1), u, v);
+	point.interpolated = isfinite(blended);
+	point.mass = point.interpolated ? blended : isfinite(nearest) ? nearest : __DBL_MAX__;
+	point.feasible = point.mass != __DBL_MAX__;
+
+	if (isfinite(nearest)) {
+		const char* stage = node(nearI, nearJ) + 8;
+		for (uint32_t s = 0; s < stages; s++, stage += 4) {
+			const uint32_t row = get16(stage);
+			const int count = get16(stage + 2);
+			point.stages.emplace_back(row < engineCount ? text(engineTable + 8 * row) : string_view(), count);
+		}
+	}
+
+	return point;
+}
+
+MultiArgs KSP::Atlas::mission(int planet, uint32_t stages, double payload, double deltaV) const {
+	const char* profile = planetTable + 16 * planetCount;
+
+	MultiArgs args{ payload, deltaV, Dat::get64(planetTable + 16 * planet + 8), (int)stages, vector<double>(stages), vector<double>(stages), maxEngines };
+	for (uint32_t s = 0; s < stages; s++) {
+		args.atm[s] = Dat::get64(profile + 8 * s);
+		args.twr[s] = Dat::get64(profile + 8 * (stageCount + s));
+	}
+
+	return args;
+}
+
+int KSP::runAtlasQueries(const string& path, const Catalog& catalog, double maxError) {
+	const Atlas atlas(path);
+	if (!atlas.valid()) {
+		cerr << "couldn't read an atlas from " << path << endl;
+		return 1;
+	}
+	if (atlas.catalog() != catalog.hash) cerr << path << " was solved with other parts than the ones loaded now" << endl;
+
+	// for missions the atlas can't answer
+	StageCache cache(1 << 16);
+	SolveArena arena;
+	const SolveContext context{ catalog.engines, 1, nullptr, &cache, nullptr, &arena };
+
+	for (string text; getline(cin, text);) {
+		if (text.find_first_not_of(" \t\r") == string::npos) continue;
+
+		stringstream line(text);
+		string name;
+		uint32_t stages = 0;
+		double payload = 0.0, deltaV = 0.0;
+		line >> name >> stages >> payload >> deltaV;
+
+		json result = { { "planet", name }, { "stages", stages }, { "payload", payload }, { "deltaV", deltaV } };
+		const int planet = atlas.planet(name);
+		if (!line) result["error"] = "expected planet, stage count, payload and delta-v";
+		else if (planet < 0) result["error"] = "no planet called " + name;
+		else if (stages < 1 || stages > atlas.maxStages()) result["error"] = "stage count has to be from 1 to " + to_string(atlas.maxStages());
+		else {
+			// off the grid, or given a limit, a cell measured worse than it or next to the edge of
+			// what flies, where nothing was measured
+			const AtlasPoint point = atlas.lookup(planet, stages, payload, deltaV);
+			const bool limited = maxError < __DBL_MAX__;
+			if (!point.inGrid || (limited && (!point.interpolated || point.error > maxError))) {
+				try {
+					result.update(rocketJson(solveMission(context, atlas.mission(planet, stages, payload, deltaV), BatchSolver::Exact)));
+					result["solved"] = true;
+				}
+				catch (const exception& e) {
+					result["error"] = e.what();
+				}
+			}
+			else if (!point.feasible) result["error"] = "no rocket can fly this mission";
+			else {
+				json nodeStages = json::array();
+				for (const auto& [engine, count] : point.stages) nodeStages.push_back({ { "engine", engine }, { "count", count } });
+
+				result["mass"] = point.mass;
+				result["interpolated"] = point.interpolated;
+				result["interpolationError"] = point.error;
+				result["node"] = { { "payload", point.nodePayload }, { "deltaV", point.nodeDeltaV }, { "stages", move(nodeStages) } };
+			}
+		}
+
+		cout << result.dump() << '\n';
+	}
+
+	return cout ? 0 : 1;
+}
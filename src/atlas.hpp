@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "batch.hpp"
+
+using namespace std;
+
+namespace KSP {
+	// The grid an atlas is solved over, for every body in `bodies` and every stage count from 1
+	// to `maxStages`. Payloads are spaced geometrically, delta-v evenly. A sheet with fewer
+	// stages than the profile takes its first (bottom) atm and twr values.
+	struct AtlasSpec {
+		double minPayload = 0.1;
+		double maxPayload = 100.0;
+		uint32_t payloads = 48;
+
+		double minDeltaV = 250.0;
+		double maxDeltaV = 12000.0;
+		uint32_t deltaVs = 48;
+
+		uint32_t maxStages = 3;
+		vector<double> atm = { 1.0, 0.5, 0.0 }; // bottom stage first, as MultiArgs keeps them
+		vector<double> twr = { 1.2, 0.8, 0.5 };
+		int maxEngines = 9;
+
+		BatchSolver solver = BatchSolver::Exact;
+	};
+
+	// Solves every grid node in `spec` and writes the atlas to `path`, progress to stderr. The
+	// centre of every cell gets solved as well, to measure how far off interpolating across that
+	// cell is, which makes building take about twice as long as the nodes alone.
+	bool buildAtlas(const string& path, const Catalog& catalog, const AtlasSpec& spec, int threads);
+
+	// What an atlas says about one mission: the mass interpolated between the four nodes
+	// around it, and the rocket at the nearest of them. Nothing off the grid gets an answer,
+	// a lookup there only says so.
+	struct AtlasPoint {
+		double mass = __DBL_MAX__;
+		bool feasible = false;
+		bool inGrid = false; // false outside the payloads and delta-vs solved, nothing else is filled in then
+		bool interpolated = false; // false next to the edge of what can fly, `mass` is the nearest node's then
+
+		// relative interpolation error at the centre of the cell, see buildAtlas. A sample rather than
+		// a bound: where an engine count steps between the nodes, points off the centre can be
+		// further off than it says. Callers that need a limit solve cells above it instead, see
+		// runAtlasQueries.
+		double error = 0.0;
+
+		double nodePayload = 0.0;
+		double nodeDeltaV = 0.0;
+		vector<pair<string_view, int>> stages; // engine and count at the nearest node, top stage first
+	};
+
+	// An atlas file mapped read only, every lookup going straight to the nodes it needs. All
+	// little endian:
+	//
+	//   header   char magic[8] "ROCKATL\0", u32 version, u32 header size, u64 catalog hash,
+	//            u32 planets, u32 max stages, u32 payloads, u32 delta-vs, u32 engines,
+	//            u32 string table size, f64 min and max payload, f64 min and max delta-v,
+	//            u32 max engines per stage, 4 bytes reserved
+	//   planets  per planet u32 name offset, u32 name length, f64 gravity
+	//   profile  f64 atm[max stages], f64 twr[max stages]
+	//   engines  per engine u32 name offset, u32 name length
+	//   sheets   per planet, per stage count n from 1: f64 worst error, then per node (payload
+	//            major) f32 mass (infinite when nothing flies), f32 error of the cell the node is
+	//            the low corner of, per stage top first u16 engine, u16 count
+	//   strings  every name back to back
+	//
+	// The mass is interpolated bilinearly in log mass over log payload and delta-v, which is
+	// exact for a rocket that grows like payload * exp(k * delta-v).
+	class Atlas {
+	public:
+		Atlas(const string& path); // empty if the file can't be mapped or isn't valid
+		~Atlas();
+
+		Atlas(const Atlas&) = delete;
+		Atlas& operator=(const Atlas&) = delete;
+
+		bool valid() const { return data != nullptr; }
+		uint64_t catalog() const { return catalogHash; } // the Catalog::hash it was solved with
+
+		int planet(string_view name) const; // -1 if it isn't in the atlas
+		size_t planets() const { return planetCount; }
+		uint32_t maxStages() const { return stageCount; }
+
+		// `stages` from 1 to maxStages()
+		AtlasPoint lookup(int planet, uint32_t stages, double payload, double deltaV) const;
+
+		// the mission a sheet was solved for, at any payload and delta-v, for solving what a lookup
+		// can't answer
+		MultiArgs mission(int planet, uint32_t stages, double payload, double deltaV) const;
+
+	private:
+		const char* sheet(int planet, uint32_t stages) const;
+		string_view text(const char* ref) const; // a name offset and length into the string table
+
+		const char* data = nullptr;
+		size_t bytes = 0;
+
+		uint64_t catalogHash = 0;
+		size_t planetCount = 0;
+		uint32_t stageCount = 0;
+		uint32_t payloads = 0;
+		uint32_t deltaVs = 0;
+		int maxEngines = 0;
+		double minPayload = 0.0, maxPayload = 0.0;
+		double minDeltaV = 0.0, maxDeltaV = 0.0;
+
+		const char* planetTable = nullptr;
+		const char* engineTable = nullptr;
+		size_t engineCount = 0;
+		const char* strings = nullptr;
+		size_t stringsSize = 0;
+
+		vector<size_t> sheets; // offset of every sheet, planet major
+	};
+
+	// Answers lookups from stdin, a line of "planet stages payload deltaV" each, with a JSON line
+	// each on stdout: the AtlasPoint, or an "error" message. Missions off the grid are solved
+	// exactly on `catalog` instead and marked "solved", and so is every one whose cell's error is
+	// above `maxError`, or wasn't measured, when one is given. Returns the exit code.
+	int runAtlasQueries(const string& path, const Catalog& catalog, double maxError = __DBL_MAX__);
+};
@@ -0,0 +1,218 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <nlohmann/json.hpp>
+
+#include "batch.hpp"
+#include "parallel.hpp"
+
+using json = nlohmann::json;
+
+using namespace std;
+using namespace KSP;
+
+namespace {
+	struct Mission {
+		size_t line; // in the input file, from 1
+		json record;
+		string error; // set when the line couldn't be read at all
+	};
+
+	vector<string> splitCells(const string& text, char separator) {
+		vector<string> cells;
+		stringstream stream(text);
+		for (string cell; getline(stream, cell, separator);) {
+			const size_t first = cell.find_first_not_of(" \t\r"), last = cell.find_last_not_of(" \t\r");
+			cells.push_back(first == string::npos ? string() : cell.substr(first, last - first + 1));
+		}
+		if (!text.empty() && text.back() == separator) cells.emplace_back();
+
+		return cells;
+	}
+
+	double number(const string& cell, const string& column) {
+		size_t used = 0;
+		double value = 0.0;
+		try {
+			value = stod(cell, &used);
+		}
+		catch (const logic_error&) {}
+
+		if (used == 0 || used != cell.size()) throw runtime_error("\"" + cell + "\" in " + column + " isn't a number");
+		return value;
+	}
+
+	// a CSV row as the same record a JSON line would be, so both go through one reader
+	json csvRecord(const vector<string>& header, const string& text) {
+		const vector<string> cells = splitCells(text, ',');
+		if (cells.size() != header.size()) throw runtime_error("expected " + to_string(header.size()) + " cells, got " + to_string(cells.size()));
+
+		json record = json::object();
+		for (size_t i = 0; i < header.size(); i++) {
+			if (header[i] == "id" || header[i] == "body") {
+				if (!cells[i].empty()) record[header[i]] = cells[i];
+			}
+			else if (header[i] == "atm" || header[i] == "twr" || header[i] == "altitude") {
+				json values = json::array();
+				for (const string& value : splitCells(cells[i], ';')) values.push_back(number(value, header[i]));
+				record[header[i]] = values;
+			}
+			else if (!cells[i].empty()) record[header[i]] = number(cells[i], header[i]);
+		}
+
+		return record;
+	}
+};
+
+KSP::BatchSolver KSP::batchSolver(const string& name) {
+	if (name == "sweep") return BatchSolver::Sweep;
+	if (name == "split") return BatchSolver::Split;
+	return BatchSolver::Exact;
+}
+
+MultiArgs KSP::missionArgs(const json& record) {
+	const int body = findBody(record.value("body", "Kerbin"));
+	if (body < 0) throw runtime_error("there's no body called " + record.at("body").get<string>());
+
+	// start altitudes go through the body's pressure curve, the solvers only know atm
+	if (record.contains("atm") && record.contains("altitude")) throw runtime_error("give either atm or altitude, not both");
+	const vector<double> atm = record.contains("altitude") ? pressures(bodies[body], record.at("altitude").get<vector<double>>()) :
+		record.at("atm").get<vector<double>>();
+
+	MultiArgs args{ record.at("payload").get<double>(), record.at("deltaV").get<double>(), record.value("gravity", bodies[body].gravity), 0,
+		atm, record.at("twr").get<vector<double>>() };
+	args.maxEngines = record.value("maxEngines", args.maxEngines);
+	args.decouplerMass = record.value("decouplerMass", args.decouplerMass);
+
+	if (args.atm.empty() || args.atm.size() != args.twr.size()) throw runtime_error("atm (or altitude) and twr need one value per stage");
+	if (args.maxEngines < 1) throw runtime_error("maxEngines has to be at least 1");
+	args.stageCount = args.atm.size();
+
+	return args;
+}
+
+vector<Stage> KSP::solveMission(const SolveContext& context, const MultiArgs& args, BatchSolver solver, SolutionCache* solutions) {
+	// the GUI's defaults
+	const uint32_t parameter = solver == BatchSolver::Sweep ? 1000 : solver == BatchSolver::Split ? 60 : 200;
+	const SolutionKey key{ args, (uint32_t)solver, parameter, context.cache ? context.cache->quantum() : 0.0, context.tanks != nullptr };
+
+	vector<Stage> rocket;
+	if (solutions && solutions->find(key, rocket)) return rocket;
+
+	if (solver == BatchSolver::Sweep) rocket = sweepMulti(context, args, parameter);
+	else if (solver == BatchSolver::Split) rocket = optimizeSplitMulti(context, args, parameter);
+	else rocket = findOptimalMulti(context, args, parameter);
+
+	if (solutions) solutions->insert(key, rocket);
+	return rocket;
+}
+
+json KSP::rocketJson(const vector<Stage>& rocket) {
+	if (rocket.empty() || !rocket.back().feasible()) throw runtime_error("no rocket can fly this mission");
+
+	json stages = json::array();
+	for (const auto& stage : rocket) stages.push_back({ { "engine", stage.engine.name }, { "count", stage.count }, { "mass", stage.mass } });
+
+	return { { "mass", rocket.back().mass }, { "stages", move(stages) } };
+}
+
+int KSP::runBatch(const string& path, const Catalog& catalog, const BatchOptions& options) {
+	ifstream input(path);
+	if (!input) {
+		cerr << "couldn't open " << path << endl;
+		return 1;
+	}
+
+	ofstream file;
+	if (!options.output.empty()) {
+		file.open(options.output);
+		if (!file) {
+			cerr << "couldn't write " << options.output << endl;
+			return 1;
+		}
+	}
+	ostream& out = options.output.empty() ? cout : file;
+
+	const bool csv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+	vector<string> header;
+
+	// shared by every mission, campaigns tend to ask for the same stages over and over
+	StageCache cache(1 << 18);
+	unique_ptr<SolutionCache> solutions;
+	if (!options.solutions.empty()) {
+		solutions = make_unique<SolutionCache>(options.solutions, catalog.hash);
+		if (!solutions->valid()) cerr << "couldn't open " << options.solutions << ", solving everything" << endl;
+	}
+	const int threads = max(options.threads, 1);
+	vector<SolveArena> arenas(threads);
+
+	size_t missions = 0, failed = 0, line = 0;
+	const auto start = chrono::steady_clock::now();
+
+	vector<Mission> window;
+	vector<string> results;
+	while (input) {
+		// read a window's worth
+		window.clear();
+		for (string text; window.size() < options.window && getline(input, text);) {
+			line++;
+			if (text.find_first_not_of(" \t\r") == string::npos) continue;
+
+			if (csv && header.empty()) {
+				header = splitCells(text, ',');
+				continue;
+			}
+
+			Mission mission{ line };
+			try {
+				mission.record = csv ? csvRecord(header, text) : json::parse(text);
+			}
+			catch (const exception& e) {
+				mission.error = e.what();
+			}
+			window.push_back(move(mission));
+		}
+		if (window.empty()) break;
+
+		// solve it, a mission per worker at a time
+		results.assign(window.size(), string());
+		atomic<size_t> windowFailed = 0;
+		parallelFor(window.size(), threads, [&](size_t i, int worker) {
+			const Mission& mission = window[i];
+
+			json result = { { "line", mission.line } };
+			if (mission.record.is_object() && mission.record.contains("id")) result["id"] = mission.record["id"];
+
+			try {
+				if (!mission.error.empty()) throw runtime_error(mission.error);
+
+				const MultiArgs args = missionArgs(mission.record);
+				const SolveContext context{ catalog.engines, 1, nullptr, &cache, nullptr, &arenas[worker] };
+				result.update(rocketJson(solveMission(context, args, options.solver, solutions.get())));
+			}
+			catch (const exception& e) {
+				result["error"] = e.what();
+				windowFailed++;
+			}
+
+			results[i] = result.dump();
+		}, 1);
+
+		// and write it out in order before reading on
+		for (const string& result : results) out << result << '\n';
+		out.flush();
+
+		missions += window.size();
+		failed += windowFailed;
+	}
+
+	const double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	fprintf(stderr, "%zu missions (%zu failed) in %.2f s on %d threads: %.1f missions/s, stage cache %zu hits, %zu misses\n",
+		missions, failed, elapsed, threads, missions / max(elapsed, 1e-9), cache.hits(), cache.misses());
+	if (solutions) fprintf(stderr, "solution cache %zu hits, %zu misses, %zu kept\n", solutions->hits(), solutions->misses(), solutions->size());
+
+	return out ? 0 : 1;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <nlohmann/json_fwd.hpp>
+
+#include "reload.hpp"
+#include "solutions.hpp"
+
+using namespace std;
+
+namespace KSP {
+	enum class BatchSolver { Sweep, Exact, Split };
+
+	BatchSolver batchSolver(const string& name); // "exact", "sweep" or "split", exact for anything else
+
+	struct BatchOptions {
+		BatchSolver solver = BatchSolver::Exact;
+		int threads = 1;
+
+		string output; // stdout when empty
+		string solutions; // a SolutionCache file to answer repeat missions from, none when empty
+
+		size_t window = 1024; // missions read, solved and written at a time, which is all that's ever held
+	};
+
+	// Solves every mission in `path` and writes one JSON result per mission, in input order, then
+	// prints throughput to stderr. Missions are JSON lines, or CSV with a header when the file ends
+	// in .csv, using MultiArgs' names:
+	//
+	//   {"id": "duna lander", "payload": 10, "deltaV": 3400, "gravity": 9.81, "atm": [1, 0.5], "twr": [1.2, 0.8]}
+	//
+	//   id,payload,deltaV,gravity,atm,twr,maxEngines,decouplerMass
+	//   duna lander,10,3400,9.81,1;0.5,1.2;0.8,9,0
+	//
+	// atm and twr run bottom stage first, as MultiArgs keeps them, and the stage count is their
+	// length. altitude, in m and bottom first too, can stand in for atm: each stage's pressure
+	// is read off body's curve. body (Kerbin) names one of `bodies` and sets the default gravity.
+	// gravity, maxEngines (9), decouplerMass (0) and id are optional. Results list
+	// stages top first, like every solver. A mission that can't be read or flown gets an "error"
+	// instead of stages and the rest carry on. Returns the exit code: 0 once everything was
+	// written, even if some missions failed.
+	int runBatch(const string& path, const Catalog& catalog, const BatchOptions& options);
+
+	// one mission record as above, throwing on anything missing or malformed
+	MultiArgs missionArgs(const nlohmann::json& record);
+	// looked up in `solutions` first when given, and kept there once solved
+	vector<Stage> solveMission(const SolveContext& context, const MultiArgs& args, BatchSolver solver, SolutionCache* solutions = nullptr);
+	nlohmann::json rocketJson(const vector<Stage>& rocket); // "mass" and "stages" of a result, throws if it can't fly
+};
@@ -0,0 +1,193 @@
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+#include <random>
+#include <functional>
+
+#include "ksp.hpp"
+#include "enginefile.hpp"
+#include "solver.hpp"
+#include "pareto.hpp"
+#include "ascent.hpp"
+#include "allocations.hpp"
+#include "catalog.generated.hpp"
+
+// Headless benchmarks of the solver hot paths. Every workload is seeded and fixed, so numbers from
+// the same machine can be compared run to run; results go to stdout as one JSON object per line.
+//
+//   build/bench [name filter] [--min-time seconds]
+
+using namespace std;
+using namespace KSP;
+
+// Workloads
+
+volatile double sink; // keeps results alive so no call gets optimised out
+
+struct Catalog {
+	string name;
+	EngineTable table;
+};
+
+// The shipped engines nudged around at random, for catalogs the size of big mod packs.
+vector<Engine> syntheticEngines(const vector<Engine>& stock, size_t count, unsigned seed) {
+	mt19937 rng(seed);
+	uniform_real_distribution<double> scale(0.7, 1.3);
+
+	vector<Engine> engines;
+	engines.reserve(count);
+	for (size_t i = 0; i < count; i++) {
+		Engine engine = stock[i % stock.size()];
+		engine.name += " #" + to_string(i);
+		engine.mass *= scale(rng);
+		engine.vacIsp *= scale(rng);
+		engine.atmIsp = min(engine.atmIsp * scale(rng), engine.vacIsp);
+		engine.vacThrust *= scale(rng);
+		engine.atmThrust = min(engine.atmThrust * scale(rng), engine.vacThrust);
+		engines.push_back(engine);
+	}
+
+	return engines;
+}
+
+MultiArgs missionFor(int stages) {
+	MultiArgs args{ 10.0, 1800.0 + 1200.0 * stages, 9.81, stages, vector<double>(stages, 0.0), vector<double>(stages, 0.8) };
+	args.atm[0] = 1.0; // bottom stage lights at sea level
+	args.twr[0] = 1.3;
+
+	return args;
+}
+
+// Runs `call` until at least `minTime` has passed and reports the average.
+void measure(const string& bench, const string& catalog, int stages, double minTime, const function<void()>& call) {
+	// warm up caches and any lazy setup, twice for arenas: they only fold into one block on the second reset
+	call();
+	call();
+
+	size_t calls = 0;
+	const size_t allocationsBefore = allocationCount();
+	const auto start = chrono::steady_clock::now();
+	double elapsed = 0.0;
+
+	do {
+		call();
+		calls++;
+		elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	} while (elapsed < minTime);
+
+	const double allocationsPerCall = (double)(allocationCount() - allocationsBefore) / calls;
+
+	printf("{\"bench\":\"%s\",\"catalog\":\"%s\",\"stages\":%d,\"calls\":%zu,\"ns_per_call\":%.1f,\"calls_per_sec\":%.1f,\"allocs_per_call\":%.1f}\n",
+		bench.c_str(), catalog.c_str(), stages, calls, elapsed * 1e9 / calls, calls / elapsed, allocationsPerCall);
+	fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+	string filter;
+	double minTime = 0.25;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--min-time") && i + 1 < argc) minTime = atof(argv[++i]);
+		else filter = argv[i];
+	}
+
+	const vector<Engine> stock = loadEngines("partdata/engines.dat");
+	if (stock.empty()) {
+		fprintf(stderr, "bench: couldn't read partdata/engines.dat, run from the repository root\n");
+		return 1;
+	}
+
+	vector<Catalog> catalogs;
+	catalogs.push_back({ "stock", EngineTable(stock) });
+	catalogs.push_back({ "embedded", EngineTable(stockTable) });
+	catalogs.push_back({ "synthetic1k", EngineTable(syntheticEngines(stock, 1000, 1)) });
+	catalogs.push_back({ "synthetic10k", EngineTable(syntheticEngines(stock, 10000, 2)) });
+
+	auto wanted = [&](const string& bench, const Catalog& catalog) {
+		return filter.empty() || (bench + "/" + catalog.name).find(filter) != string::npos;
+	};
+
+	// startup: reading the whole catalog against mapping it and building the table over the mapping
+	if (wanted("load_read", catalogs[0]))
+		measure("load_read", "stock", 0, minTime, [&] { sink = EngineTable(loadEngines("partdata/engines.dat")).size(); });
+
+	if (wanted("load_mapped", catalogs[0]))
+		measure("load_mapped", "stock", 0, minTime, [&] { sink = EngineTable(make_shared<const EngineFile>("partdata/engines.dat")).size(); });
+
+	if (wanted("load_embedded", catalogs[0]))
+		measure("load_embedded", "stock", 0, minTime, [&] { sink = EngineTable(stockTable).size(); });
+
+	for (const auto& catalog : catalogs) {
+		// a single stage over a payload x delta-v grid, at a few pressures
+		if (wanted("stage", catalog)) {
+			vector<Args> grid;
+			for (int p = 0; p < 8; p++)
+				for (int d = 0; d < 8; d++)
+					grid.push_back(Args{ 2.0 + p * 25.0, 500.0 + d * 600.0, 9.81, (p + d) % 3 * 0.5, 1.2 });
+
+			size_t next = 0;
+			measure("stage", catalog.name, 1, minTime, [&] {
+				sink = findOptimalStage(catalog.table, grid[next++ % grid.size()]).mass;
+			});
+		}
+
+		for (int stages = 1; stages <= 6; stages++) {
+			const MultiArgs args = missionFor(stages);
+			SolveArena arena; // kept across calls, like a long running caller would
+			const SolveContext context{ catalog.table, 1, nullptr, nullptr, nullptr, &arena };
+
+			// heavy catalogs only get the solvers whose cost doesn't grow with stages squared
+			const bool light = catalog.table.size() <= 1000;
+
+			if (wanted("random_multi", catalog))
+				measure("random_multi", catalog.name, stages, minTime, [&] { sink = findRandomMulti(context, args, 0.5).size(); });
+
+			// the same rocket with nothing but numbers coming out, which shouldn't allocate at all
+			if (wanted("fill_split", catalog)) {
+				vector<StagePick> rocket(stages);
+				const vector<double> splits(stages, 0.5);
+				measure("fill_split", catalog.name, stages, minTime, [&] { sink = fillSplitMulti(context, args, splits, rocket); });
+			}
+
+			if (light && wanted("sweep", catalog))
+				measure("sweep", catalog.name, stages, minTime, [&] { sink = sweepMulti(context, args, 1000).size(); });
+
+			if (light && wanted("dp", catalog))
+				measure("dp", catalog.name, stages, minTime, [&] { sink = findOptimalMulti(context, args, 100).size(); });
+
+			if (wanted("split", catalog))
+				measure("split", catalog.name, stages, minTime, [&] { sink = optimizeSplitMulti(context, args, 60).size(); });
+
+			// both searches again with picks coming out, the only allocation left above is the answer
+			if (wanted("fill_search", catalog)) {
+				vector<StagePick> rocket(stages);
+				if (light) measure("fill_dp", catalog.name, stages, minTime, [&] { sink = fillOptimalMulti(context, args, 100, rocket); });
+				measure("fill_nm", catalog.name, stages, minTime, [&] { sink = fillOptimizedSplit(context, args, 60, rocket); });
+			}
+
+			if (light && wanted("pareto", catalog))
+				measure("pareto", catalog.name, stages, minTime, [&] { sink = findParetoMulti(context, args, 50).size(); });
+
+			// the front left as picks, without building the Stages it returns
+			if (light && wanted("fill_pareto", catalog))
+				measure("fill_pareto", catalog.name, stages, minTime, [&] { sink = findParetoPicks(context, args, 50).size(); });
+
+			// a thousand candidates off Kerbin in one batch, taken round robin from a trade-off front
+			if (light && wanted("ascent", catalog)) {
+				const vector<vector<Stage>> front = findParetoMulti(context, args, 50);
+				vector<vector<Stage>> candidates;
+				for (size_t i = 0; !front.empty() && i < 1000; i++) candidates.push_back(front[i % front.size()]);
+
+				const Body& kerbin = bodies[findBody("Kerbin")];
+				const AltitudeTable table(kerbin, catalog.table);
+				if (!candidates.empty())
+					measure("ascent", catalog.name, stages, minTime, [&] { sink = scoreAscents(kerbin, table, catalog.table, {}, args, candidates).size(); });
+			}
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,59 @@
+#include <cmath>
+
+#include "bodies.hpp"
+
+using namespace std;
+using namespace KSP;
+
+double KSP::Body::pressure(double altitude) const {
+	if (curve.empty() || altitude >= atmosphereHeight) return 0.0;
+	if (altitude <= curve.front().altitude) return curve.front().pressure;
+
+	size_t i = 1;
+	while (i + 1 < curve.size() && curve[i].altitude < altitude) i++;
+
+	const AltitudePoint& low = curve[i - 1];
+	const AltitudePoint& high = curve[i];
+	const double t = (altitude - low.altitude) / (high.altitude - low.altitude);
+
+	// exponential between points, and straight down to nothing on the last one
+	if (low.pressure > 0.0 && high.pressure > 0.0) return low.pressure * pow(high.pressure / low.pressure, t);
+	return lerp(low.pressure, high.pressure, t);
+}
+
+int KSP::findBody(string_view name) {
+	for (size_t i = 0; i < size(bodies); i++)
+		if (name == bodies[i].name) return (int)i;
+
+	return -1;
+}
+
+vector<double> KSP::pressures(const Body& body, span<const double> altitudes) {
+	vector<double> atm;
+	for (double altitude : altitudes) atm.push_back(body.pressure(altitude));
+
+	return atm;
+}
+
+// AltitudeTable
+
+KSP::AltitudeTable::AltitudeTable(const Body& body, const EngineTable& engines, size_t samples) {
+	count = body.hasAtmosphere() ? max(samples, (size_t)2) : 2;
+	inverseStep = body.hasAtmosphere() ? (count - 1) / body.atmosphereHeight : 0.0;
+
+	pressures.resize(count);
+	densities.resize(count);
+	for (size_t k = 0; k < count; k++) {
+		pressures[k] = body.pressure(body.atmosphereHeight * k / (count - 1));
+		densities[k] = body.curve.empty() ? 0.0 : body.density * pressures[k] / body.curve.front().pressure;
+	}
+
+	isps.resize(engines.size() * count);
+	thrusts.resize(engines.size() * count);
+	for (size_t e = 0; e < engines.size(); e++) {
+		for (size_t k = 0; k < count; k++) {
+			isps[e * count + k] = max(lerp(engines.vacIsp[e], engines.atmIsp[e], pressures[k]), 1.0);
+			thrusts[e * count + k] = max(lerp(engines.vacThrust[e], engines.atmThrust[e], pressures[k]), 0.0);
+		}
+	}
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "solver.hpp"
+
+using namespace std;
+
+namespace KSP {
+	struct AltitudePoint {
+		double altitude; // m
+		double pressure; // atm
+	};
+
+	// A celestial body as far as flying off it goes. Pressure follows `curve`, points by rising
+	// altitude ending at 0 atm on `atmosphereHeight`, and density scales with it from `density`.
+	struct Body {
+		const char* name;
+
+		double radius; // m
+		double gravity; // at the surface, m/s^2
+
+		double atmosphereHeight = 0.0; // m, 0 without an atmosphere
+		double density = 0.0; // at the surface, kg/m^3
+		span<const AltitudePoint> curve = {};
+
+		double pressure(double altitude) const; // atm, 0 in vacuum
+		bool hasAtmosphere() const { return atmosphereHeight > 0.0; }
+	};
+
+	// close to the stock curves, exponential between the points
+	inline constexpr AltitudePoint kerbinCurve[] = {
+		{ 0, 1.0 }, { 2500, 0.69 }, { 5000, 0.47 }, { 7500, 0.32 }, { 10000, 0.22 }, { 15000, 0.10 }, { 20000, 0.046 },
+		{ 25000, 0.021 }, { 30000, 0.0095 }, { 40000, 0.0021 }, { 50000, 0.00045 }, { 60000, 0.00009 }, { 70000, 0.0 }
+	};
+	inline constexpr AltitudePoint eveCurve[] = {
+		{ 0, 5.0 }, { 5000, 2.5 }, { 10000, 1.25 }, { 20000, 0.31 }, { 30000, 0.078 }, { 40000, 0.019 },
+		{ 50000, 0.0048 }, { 60000, 0.0012 }, { 70000, 0.0003 }, { 80000, 0.00007 }, { 90000, 0.0 }
+	};
+	inline constexpr AltitudePoint dunaCurve[] = {
+		{ 0, 0.0666 }, { 5000, 0.035 }, { 10000, 0.018 }, { 20000, 0.0048 }, { 30000, 0.0012 }, { 40000, 0.0003 }, { 50000, 0.0 }
+	};
+	inline constexpr AltitudePoint joolCurve[] = {
+		{ 0, 15.0 }, { 25000, 5.0 }, { 50000, 1.5 }, { 75000, 0.45 }, { 100000, 0.13 }, { 125000, 0.037 },
+		{ 150000, 0.01 }, { 175000, 0.002 }, { 200000, 0.0 }
+	};
+	inline constexpr AltitudePoint laytheCurve[] = {
+		{ 0, 0.6 }, { 5000, 0.3 }, { 10000, 0.14 }, { 20000, 0.034 }, { 30000, 0.0079 }, { 40000, 0.0018 }, { 50000, 0.0 }
+	};
+
+	// None is for missions where thrust to weight doesn't matter
+	inline constexpr Body bodies[17] = {
+		{ "None", 600000.0, 0.0 },
+		{ "Moho", 250000.0, 2.70 },
+		{ "Eve", 700000.0, 16.7, 90000.0, 6.2, eveCurve },
+		{ "Gilly", 13000.0, 0.049 },
+		{ "Kerbin", 600000.0, 9.81, 70000.0, 1.225, kerbinCurve },
+		{ "Mun", 200000.0, 1.63 },
+		{ "Minmus", 60000.0, 0.491 },
+		{ "Duna", 320000.0, 2.94, 50000.0, 0.149, dunaCurve },
+		{ "Ike", 130000.0, 1.10 },
+		{ "Dres", 138000.0, 1.13 },
+		{ "Jool", 6000000.0, 7.85, 200000.0, 6.8, joolCurve },
+		{ "Laythe", 500000.0, 7.85, 50000.0, 0.76, laytheCurve },
+		{ "Vall", 300000.0, 2.31 },
+		{ "Tylo", 600000.0, 7.85 },
+		{ "Bop", 65000.0, 0.589 },
+		{ "Pol", 44000.0, 0.373 },
+		{ "Eeloo", 210000.0, 1.69 }
+	};
+
+	int findBody(string_view name); // index into bodies, -1 if there's none by that name
+
+	// what a stage lighting at each altitude burns in, for entering altitudes instead of pressures
+	vector<double> pressures(const Body& body, span<const double> altitudes);
+
+	// A body's pressure and density and every engine's Isp and thrust, sampled at even steps from
+	// the ground to the top of the atmosphere when the catalog loads. Anything flying through it
+	// interpolates between two samples instead of walking the curve and lerping every engine.
+	// Above the last sample is vacuum, and a body without air gets just the two vacuum samples.
+	class AltitudeTable {
+	public:
+		AltitudeTable() = default;
+		AltitudeTable(const Body& body, const EngineTable& engines, size_t samples = 128);
+
+		// sample `i` and how far it is on to `i + 1`
+		void locate(double altitude, size_t& i, double& fraction) const {
+			const double position = clamp(altitude * inverseStep, 0.0, (double)(count - 1));
+			i = min((size_t)position, count - 2);
+			fraction = position - i;
+		}
+
+		size_t samples() const { return count; }
+
+		// columns of samples, the engine ones row after row in the EngineTable's order
+		span<const double> pressure() const { return pressures; }
+		span<const double> density() const { return densities; }
+		span<const double> isp() const { return isps; }
+		span<const double> thrust() const { return thrusts; }
+
+	private:
+		size_t count = 0;
+		double inverseStep = 0.0;
+
+		vector<double> pressures;
+		vector<double> densities;
+		vector<double> isps;
+		vector<double> thrusts;
+	};
+};
@@ -0,0 +1,95 @@
+#include <bit>
+#include <cmath>
+
+#include "cache.hpp"
+
+using namespace std;
+using namespace KSP;
+
+KSP::StageCache::StageCache(size_t capacity, double quantum)
+	: step(quantum), shardCapacity(max<size_t>(capacity / shardCount, 1)) {}
+
+Args KSP::StageCache::snap(Args args) const {
+	if (step <= 0.0) return args;
+
+	for (double* value : { &args.payload, &args.deltaV, &args.gravity, &args.atm, &args.twr })
+		*value = round(*value / step) * step;
+
+	return args;
+}
+
+KSP::StageCache::Key KSP::StageCache::key(const Args& args, bool options) const {
+	auto quantize = [&](double value) { return step > 0.0 ? llround(value / step) : bit_cast<int64_t>(value); };
+
+	return Key{ quantize(args.payload), quantize(args.deltaV), quantize(args.atm), quantize(args.twr), quantize(args.gravity), args.maxEngines, options };
+}
+
+size_t KSP::StageCache::KeyHash::operator()(const Key& key) const {
+	uint64_t hash = 0xcbf29ce484222325;
+	for (int64_t part : { key.payload, key.deltaV, key.atm, key.twr, key.gravity, (int64_t)key.maxEngines, (int64_t)key.options })
+		hash = (hash ^ (uint64_t)part) * 0x100000001b3;
+
+	return hash ^ (hash >> 29);
+}
+
+KSP::StageCache::Entry* KSP::StageCache::lookup(const Key& k) {
+	Shard& s = shard(k);
+
+	auto it = s.index.find(k);
+	if (it == s.index.end()) {
+		missCount++;
+		return nullptr;
+	}
+
+	s.order.splice(s.order.begin(), s.order, it->second);
+	hitCount++;
+
+	return &it->second->second;
+}
+
+void KSP::StageCache::store(const Key& k, Entry entry) {
+	Shard& s = shard(k);
+	if (s.index.contains(k)) return; // another thread solved it meanwhile
+
+	s.order.emplace_front(k, move(entry));
+	s.index.emplace(k, s.order.begin());
+
+	if (s.order.size() > shardCapacity) {
+		s.index.erase(s.order.back().first);
+		s.order.pop_back();
+	}
+}
+
+bool KSP::StageCache::find(const Args& args, StagePick& stage) {
+	const Key k = key(args);
+
+	lock_guard guard(shard(k).lock);
+	const Entry* entry = lookup(k);
+	if (entry) stage = entry->stage;
+
+	return entry != nullptr;
+}
+
+void KSP::StageCache::insert(const Args& args, const StagePick& stage) {
+	const Key k = key(args);
+
+	lock_guard guard(shard(k).lock);
+	store(k, Entry{ stage, {} });
+}
+
+bool KSP::StageCache::findOptions(const Args& args, vector<StagePick>& options) {
+	const Key k = key(args, true);
+
+	lock_guard guard(shard(k).lock);
+	const Entry* entry = lookup(k);
+	if (entry) options = entry->options;
+
+	return entry != nullptr;
+}
+
+void KSP::StageCache::insertOptions(const Args& args, const vector<StagePick>& options) {
+	const Key k = key(args, true);
+
+	lock_guard guard(shard(k).lock);
+	store(k, Entry{ StagePick{}, options });
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "ksp.hpp"
+
+using namespace std;
+
+namespace KSP {
+	// Bounded, thread safe LRU of findOptimalStage results for one engine catalog. Arguments are
+	// snapped to multiples of `quantum` before they are looked up or solved, so near-identical
+	// stages (neighbouring sweep fractions, or the same inputs generated twice) share an entry
+	// and every thread gets the same answer for them. A quantum of 0 keys on the exact bits.
+	// Each stage's full list of options, for the trade-off search, is kept apart from its pick.
+	class StageCache {
+	public:
+		StageCache(size_t capacity = 1 << 16, double quantum = 1e-3);
+
+		Args snap(Args args) const;
+
+		bool find(const Args& args, StagePick& stage); // args must already be snapped
+		void insert(const Args& args, const StagePick& stage);
+
+		bool findOptions(const Args& args, vector<StagePick>& options);
+		void insertOptions(const Args& args, const vector<StagePick>& options);
+
+		double quantum() const { return step; }
+		size_t hits() const { return hitCount; }
+		size_t misses() const { return missCount; }
+
+	private:
+		struct Key {
+			int64_t payload, deltaV, atm, twr, gravity;
+			int maxEngines;
+			bool options; // the entry is a list of options rather than one pick
+
+			bool operator==(const Key&) const = default;
+		};
+
+		struct KeyHash {
+			size_t operator()(const Key& key) const;
+		};
+
+		struct Entry {
+			StagePick stage;
+			vector<StagePick> options;
+		};
+
+		// split up so threads hitting different keys rarely wait on each other
+		struct Shard {
+			mutex lock;
+			list<pair<Key, Entry>> order; // most recently used first
+			unordered_map<Key, list<pair<Key, Entry>>::iterator, KeyHash> index;
+		};
+
+		static constexpr size_t shardCount = 16;
+
+		Key key(const Args& args, bool options = false) const;
+		Entry* lookup(const Key& key); // shard locked, moved to the front when found
+		void store(const Key& key, Entry entry); // shard locked
+
+		Shard& shard(const Key& key) { return shards[KeyHash{}(key) % shardCount]; }
+
+		const double step;
+		const size_t shardCapacity;
+		Shard shards[shardCount];
+
+		atomic<size_t> hitCount = 0;
+		atomic<size_t> missCount = 0;
+	};
+};
@@ -0,0 +1,41 @@
+// Generated by serialize from parts.json, don't edit by hand.
+#pragma once
+
+#include "catalog.hpp"
+
+namespace KSP {
+	inline constexpr double stockTankRatio = 0.125; // of the lightest tank
+
+	// name, mass, vacIsp, atmIsp, vacThrust, atmThrust, tankRatio
+	inline constexpr StaticEngine stockEngines[] = {
+		{ "24-77 \"Twitch\" Liquid Fuel Engine", 0.080000000000000002, 290, 275, 16, 15.172413793103448, stockTankRatio },
+		{ "48-7S \"Spark\" Liquid Fuel Engine", 0.13, 320, 265, 20, 16.5625, stockTankRatio },
+		{ "T-1 Toroidal Aerospike \"Dart\" Liquid Fuel Engine", 1, 340, 290, 180, 153.52941176470588, stockTankRatio },
+		{ "LV-1R \"Spider\" Liquid Fuel Engine", 0.02, 290, 260, 2, 1.7931034482758621, stockTankRatio },
+		{ "LV-1 \"Ant\" Liquid Fuel Engine", 0.02, 315, 80, 2, 0.50793650793650791, stockTankRatio },
+		{ "LV-909 \"Terrier\" Liquid Fuel Engine", 0.5, 345, 85, 60, 14.782608695652174, stockTankRatio },
+		{ "LV-T30 \"Reliant\" Liquid Fuel Engine", 1.25, 310, 265, 240, 205.16129032258064, stockTankRatio },
+		{ "LV-T45 \"Swivel\" Liquid Fuel Engine", 1.5, 320, 250, 215, 167.96875, stockTankRatio },
+		{ "RE-M3 \"Mainsail\" Liquid Fuel Engine", 6, 310, 285, 1500, 1379.0322580645161, stockTankRatio },
+		{ "Mk-55 \"Thud\" Liquid Fuel Engine", 0.90000000000000002, 305, 275, 120, 108.19672131147541, stockTankRatio },
+		{ "RE-L10 \"Poodle\" Liquid Fuel Engine", 1.75, 350, 90, 250, 64.285714285714292, stockTankRatio },
+		{ "RE-I5 \"Skipper\" Liquid Fuel Engine", 3, 320, 280, 650, 568.75, stockTankRatio },
+		{ "S3 KS-25 \"Vector\" Liquid Fuel Engine", 4, 315, 295, 1000, 936.50793650793651, stockTankRatio },
+		{ "LFB KR-1x2 \"Twin-Boar\" Liquid Fuel Engine", 10.5, 300, 280, 2000, 1866.6666666666667, stockTankRatio },
+		{ "Kerbodyne KR-2L+ \"Rhino\" Liquid Fuel Engine", 9, 340, 205, 2000, 1205.8823529411766, stockTankRatio },
+		{ "S3 KS-25x4 \"Mammoth\" Liquid Fuel Engine", 15, 315, 295, 4000, 3746.031746031746, stockTankRatio },
+		{ "Kerbodyne KE-1 \"Mastodon\" Liquid Fuel Engine", 5, 305, 290, 1350, 1283.6065573770493, stockTankRatio },
+		{ "LV-T91 \"Cheetah\" Liquid Fuel Engine", 1, 355, 150, 125, 52.816901408450704, stockTankRatio },
+		{ "LV-TX87 \"Bobcat\" Liquid Fuel Engine", 2, 310, 290, 400, 374.19354838709677, stockTankRatio },
+		{ "RE-I2 \"Skiff\" Liquid Fuel Engine", 1.6000000000000001, 330, 265, 300, 240.90909090909091, stockTankRatio },
+		{ "RE-J10 \"Wolfhound\" Liquid Fuel Engine", 3.2999999999999998, 380, 70, 375, 69.078947368421055, stockTankRatio },
+		{ "RK-7 \"Kodiak\" Liquid Fueled Engine", 1.25, 300, 285, 260, 247, stockTankRatio },
+		{ "RV-1 \"Cub\" Vernier Engine", 0.17999999999999999, 310, 280, 32, 28.903225806451612, stockTankRatio },
+		{ "Mk-1H 'Torch' Liquid Fuel Engine", 0.28999999999999998, 295, 275, 55, 51.271186440677965, stockTankRatio },
+		{ "LV-303 'Pug' Liquid Fuel Engine", 0.20000000000000001, 330, 150, 25, 11.363636363636363, stockTankRatio },
+		{ "KR-1 'Boar' Liquid Fuel Engine", 3.5, 300, 280, 1000, 933.33333333333337, stockTankRatio },
+		{ "KR-10A 'Corgi' Liquid Fuel Engine Cluster", 5.25, 355, 95, 750, 200.70422535211267, stockTankRatio },
+	};
+
+	inline constexpr auto stockTable = makeEngineTable(stockEngines);
+};
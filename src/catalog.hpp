@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+
+using namespace std;
+
+namespace KSP {
+	constexpr double fuelRatio = 0.125; // LFO tanks: 1t dry per 8t of fuel
+	constexpr double nervRatio = 1.0 / 9.0; // LF only tanks the Nerv runs on
+
+	// An engine as a literal type, for catalogs that exist at compile time.
+	struct StaticEngine {
+		string_view name;
+		double mass;
+
+		double vacIsp;
+		double atmIsp;
+
+		double vacThrust;
+		double atmThrust;
+
+		double tankRatio = fuelRatio; // tank dry mass per tonne of fuel this engine burns
+	};
+
+	constexpr StaticEngine nerv{ "LV-N \"Nerv\" Atomic Rocket Motor", 3.0, 800.0, 185.0, 60.00, 13.88, nervRatio };
+
+	// The columns of an EngineTable worked out by the compiler: sorted by mass, the Nerv added,
+	// bests taken. An EngineTable over one of these only points at the arrays.
+	template<size_t N>
+	struct StaticEngineTable {
+		array<string_view, N> names{};
+
+		array<double, N> mass{};
+
+		array<double, N> vacIsp{};
+		array<double, N> atmIsp{};
+
+		array<double, N> vacThrust{};
+		array<double, N> atmThrust{};
+
+		array<double, N> tankRatio{};
+
+		double bestVacIsp = 0.0;
+		double bestAtmIsp = 0.0;
+		double lightestTankRatio = __DBL_MAX__;
+	};
+
+	template<size_t N>
+	constexpr StaticEngineTable<N + 1> makeEngineTable(const StaticEngine (&engines)[N]) {
+		array<StaticEngine, N + 1> rows{};
+		for (size_t i = 0; i < N; i++) rows[i] = engines[i];
+		rows[N] = nerv; // nerv time baby
+
+		// insertion sort, stable like the runtime table's so both agree row for row
+		for (size_t i = 1; i < rows.size(); i++) {
+			const StaticEngine row = rows[i];
+			size_t j = i;
+			for (; j > 0 && row.mass < rows[j - 1].mass; j--) rows[j] = rows[j - 1];
+			rows[j] = row;
+		}
+
+		StaticEngineTable<N + 1> table;
+		for (size_t i = 0; i < rows.size(); i++) {
+			table.names[i] = rows[i].name;
+			table.mass[i] = rows[i].mass;
+			table.vacIsp[i] = rows[i].vacIsp;
+			table.atmIsp[i] = rows[i].atmIsp;
+			table.vacThrust[i] = rows[i].vacThrust;
+			table.atmThrust[i] = rows[i].atmThrust;
+			table.tankRatio[i] = rows[i].tankRatio;
+
+			table.bestVacIsp = rows[i].vacIsp > table.bestVacIsp ? rows[i].vacIsp : table.bestVacIsp;
+			table.bestAtmIsp = rows[i].atmIsp > table.bestAtmIsp ? rows[i].atmIsp : table.bestAtmIsp;
+			table.lightestTankRatio = rows[i].tankRatio < table.lightestTankRatio ? rows[i].tankRatio : table.lightestTankRatio;
+		}
+
+		return table;
+	}
+};
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// The container every partdata/*.dat file shares. Every field is fixed width and little endian:
+//
+//   header   char magic[8], u32 version, u32 header size, u32 record count, u32 record size,
+//            u32 string table size, u32 reserved (0)
+//   records  record count * record size bytes, each starting with u32 name offset, u32 name
+//            length, then whatever the file type keeps per part
+//   strings  every name back to back, not null terminated
+//
+// Readers go by the sizes in the header, so new fields get appended to the header or the
+// records without a version bump and older readers skip over them. The version only
+// changes when existing fields move or change meaning.
+namespace KSP::Dat {
+	constexpr size_t headerSize = 32;
+
+	inline void put32(char* out, uint32_t value) {
+		for (int i = 0; i < 4; i++) out[i] = (char)(value >> (8 * i));
+	}
+
+	inline void put64(char* out, double value) {
+		const uint64_t bits = bit_cast<uint64_t>(value);
+		for (int i = 0; i < 8; i++) out[i] = (char)(bits >> (8 * i));
+	}
+
+	inline uint32_t get32(const char* in) {
+		uint32_t value = 0;
+		for (int i = 0; i < 4; i++) value |= (uint32_t)(uint8_t)in[i] << (8 * i);
+		return value;
+	}
+
+	inline double get64(const char* in) {
+		uint64_t bits = 0;
+		for (int i = 0; i < 8; i++) bits |= (uint64_t)(uint8_t)in[i] << (8 * i);
+		return bit_cast<double>(bits);
+	}
+
+	// whole integers rather than doubles, for hashes and the like
+	inline void putU64(char* out, uint64_t value) {
+		for (int i = 0; i < 8; i++) out[i] = (char)(value >> (8 * i));
+	}
+
+	inline uint64_t getU64(const char* in) {
+		uint64_t value = 0;
+		for (int i = 0; i < 8; i++) value |= (uint64_t)(uint8_t)in[i] << (8 * i);
+		return value;
+	}
+
+	// the same fields onto the end of something being built up
+	inline void append32(string& out, uint32_t value) {
+		char bytes[4];
+		put32(bytes, value);
+		out.append(bytes, 4);
+	}
+
+	inline void append64(string& out, double value) {
+		char bytes[8];
+		put64(bytes, value);
+		out.append(bytes, 8);
+	}
+
+	inline void appendU64(string& out, uint64_t value) {
+		char bytes[8];
+		putU64(bytes, value);
+		out.append(bytes, 8);
+	}
+
+	// FNV-1a, for telling files and their contents apart rather than anything adversarial
+	inline uint64_t hash(const char* data, size_t size, uint64_t hash = 0xcbf29ce484222325) {
+		for (size_t i = 0; i < size; i++) hash = (hash ^ (uint8_t)data[i]) * 0x100000001b3;
+		return hash;
+	}
+
+	struct Layout {
+		size_t headerSize;
+		size_t count;
+		size_t recordSize;
+		size_t stringsSize;
+
+		const char* records(const char* data) const { return data + headerSize; }
+		const char* strings(const char* data) const { return data + headerSize + count * recordSize; }
+	};
+
+	// Checks everything the header promises against the real size, so readers can go without
+	// bounds checks afterwards (name offsets excepted, those live in the records).
+	inline bool readLayout(const char* data, size_t size, const char (&magic)[8], uint32_t version, size_t recordSize, Layout& layout) {
+		if (size < Dat::headerSize || memcmp(data, magic, sizeof(magic)) != 0) return false;
+		if (get32(data + 8) != version) return false;
+
+		layout = Layout{ get32(data + 12), get32(data + 16), get32(data + 20), get32(data + 24) };
+
+		if (layout.headerSize < Dat::headerSize || layout.recordSize < recordSize) return false;
+		if (layout.count > size / layout.recordSize) return false;
+
+		return layout.headerSize + layout.count * layout.recordSize + layout.stringsSize == size;
+	}
+
+	// Name `i` of a file read with `layout`, false if the record points outside the string table.
+	inline bool readName(const char* data, const Layout& layout, const char* record, string_view& name) {
+		const size_t offset = get32(record);
+		const size_t length = get32(record + 4);
+		if (offset + length > layout.stringsSize) return false;
+
+		name = string_view(layout.strings(data) + offset, length);
+		return true;
+	}
+
+	// Lays out a whole file of `names.size()` records. `fill(i, record)` writes record i's fields
+	// after the name, the first 8 bytes are already taken care of.
+	template<class Fill>
+	bool build(const char (&magic)[8], uint32_t version, size_t recordSize, const vector<string_view>& names, Fill&& fill, vector<char>& data) {
+		size_t stringsSize = 0;
+		for (const auto& name : names) stringsSize += name.size();
+		if (names.size() > UINT32_MAX || stringsSize > UINT32_MAX) return false;
+
+		const size_t recordsSize = names.size() * recordSize;
+		data.assign(Dat::headerSize + recordsSize + stringsSize, 0);
+
+		memcpy(data.data(), magic, sizeof(magic));
+		put32(&data[8], version);
+		put32(&data[12], Dat::headerSize);
+		put32(&data[16], names.size());
+		put32(&data[20], recordSize);
+		put32(&data[24], stringsSize);
+
+		char* record = &data[Dat::headerSize];
+		char* strings = record + recordsSize;
+		size_t nameOffset = 0;
+
+		for (size_t i = 0; i < names.size(); i++) {
+			put32(record, nameOffset);
+			put32(record + 4, names[i].size());
+			fill(i, record);
+
+			memcpy(strings + nameOffset, names[i].data(), names[i].size());
+			nameOffset += names[i].size();
+			record += recordSize;
+		}
+
+		return true;
+	}
+
+	// the whole file in one read
+	inline bool readFile(const string& path, vector<char>& data) {
+		ifstream file(path, ios::binary | ios::ate);
+		if (!file) return false;
+
+		data.resize((size_t)file.tellg());
+		file.seekg(0);
+
+		return (bool)file.read(data.data(), data.size());
+	}
+
+	// Replaces `path` in one atomic rename, so a reader (or rock mapping it) sees either the old
+	// file or the new one and never half of each. A file that already holds exactly `data` is
+	// left alone, timestamp and all.
+	inline bool writeFile(const string& path, const vector<char>& data) {
+		vector<char> existing;
+		if (readFile(path, existing) && existing == data) return true;
+
+		const string temporary = path + ".tmp";
+		{
+			ofstream file(temporary, ios::binary | ios::trunc);
+			file.write(data.data(), data.size());
+			if (!file.flush()) return false;
+		}
+
+		error_code error, ignored;
+		filesystem::rename(temporary, path, error);
+		if (error) filesystem::remove(temporary, ignored);
+
+		return !error;
+	}
+};
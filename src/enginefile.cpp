@@ -0,0 +1,188 @@
+#include <bit>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "enginefile.hpp"
+#include "datfile.hpp"
+
+using namespace std;
+using namespace KSP;
+
+// engines.dat, version 2, in the container from datfile.hpp. Each record is an EngineRecord.
+
+namespace {
+	constexpr char engineMagic[8] = { 'R', 'O', 'C', 'K', 'E', 'N', 'G', '\0' };
+	constexpr uint32_t engineVersion = 2;
+}
+
+// EngineFile
+
+KSP::EngineFile::EngineFile(const string& path) {
+	// records are read in place, which needs the file's byte order
+	if constexpr (endian::native != endian::little) return;
+
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) return;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+		close(fd);
+		return;
+	}
+
+	void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd); // the mapping keeps the file alive
+	if (mapping == MAP_FAILED) return;
+
+	data = (const char*)mapping;
+	bytes = info.st_size;
+
+	// and in place means aligned, which the v2 sizes keep unless a writer pads oddly
+	Dat::Layout layout;
+	if (!Dat::readLayout(data, bytes, engineMagic, engineVersion, sizeof(EngineRecord), layout) ||
+		layout.headerSize % alignof(EngineRecord) || layout.recordSize % alignof(EngineRecord)) {
+		*this = EngineFile();
+		return;
+	}
+
+	records = layout.records(data);
+	count = layout.count;
+	stride = layout.recordSize;
+
+	strings = layout.strings(data);
+	stringsSize = layout.stringsSize;
+}
+
+KSP::EngineFile::~EngineFile() {
+	if (data) munmap((void*)data, bytes);
+}
+
+KSP::EngineFile::EngineFile(EngineFile&& other) noexcept {
+	*this = move(other);
+}
+
+KSP::EngineFile& KSP::EngineFile::operator=(EngineFile&& other) noexcept {
+	if (this == &other) return *this;
+	if (data) munmap((void*)data, bytes);
+
+	data = exchange(other.data, nullptr);
+	bytes = exchange(other.bytes, 0);
+	records = exchange(other.records, nullptr);
+	count = exchange(other.count, 0);
+	stride = exchange(other.stride, 0);
+	strings = exchange(other.strings, nullptr);
+	stringsSize = exchange(other.stringsSize, 0);
+
+	return *this;
+}
+
+string_view KSP::EngineFile::name(size_t i) const {
+	const EngineRecord& engine = record(i);
+	if ((size_t)engine.nameOffset + engine.nameLength > stringsSize) return {};
+
+	return string_view(strings + engine.nameOffset, engine.nameLength);
+}
+
+KSP::Engine KSP::EngineFile::operator[](size_t i) const {
+	const EngineRecord& engine = record(i);
+	return Engine{ string(name(i)), engine.mass, engine.vacIsp, engine.atmIsp, engine.vacThrust, engine.atmThrust };
+}
+
+// Whole file reads and writes
+
+bool KSP::writeEngines(const string& path, const vector<Engine>& engines) {
+	vector<string_view> names;
+	for (const auto& engine : engines) names.push_back(engine.name);
+
+	vector<char> data;
+	const bool built = Dat::build(engineMagic, engineVersion, sizeof(EngineRecord), names, [&](size_t i, char* record) {
+		Dat::put64(record + 8, engines[i].mass);
+		Dat::put64(record + 16, engines[i].vacIsp);
+		Dat::put64(record + 24, engines[i].atmIsp);
+		Dat::put64(record + 32, engines[i].vacThrust);
+		Dat::put64(record + 40, engines[i].atmThrust);
+	}, data);
+
+	return built && Dat::writeFile(path, data);
+}
+
+bool KSP::writeEngineHeader(const string& path, const vector<Engine>& engines, double tankRatio) {
+	if (engines.empty()) return false; // no zero length arrays, and no use for an empty catalog either
+
+	string out =
+		"// Generated by serialize from parts.json, don't edit by hand.\n"
+		"#pragma once\n"
+		"\n"
+		"#include \"catalog.hpp\"\n"
+		"\n"
+		"namespace KSP {\n";
+
+	char ratio[96];
+	snprintf(ratio, sizeof(ratio), "\tinline constexpr double stockTankRatio = %.17g; // of the lightest tank\n\n", tankRatio);
+	out += ratio;
+
+	out +=
+		"\t// name, mass, vacIsp, atmIsp, vacThrust, atmThrust, tankRatio\n"
+		"\tinline constexpr StaticEngine stockEngines[] = {\n";
+
+	for (const auto& engine : engines) {
+		string name;
+		for (char c : engine.name) {
+			if (c == '"' || c == '\\') name += '\\';
+			name += c;
+		}
+
+		// 17 digits so every double comes back bit for bit
+		char numbers[160];
+		snprintf(numbers, sizeof(numbers), "%.17g, %.17g, %.17g, %.17g, %.17g", engine.mass, engine.vacIsp, engine.atmIsp, engine.vacThrust, engine.atmThrust);
+
+		out += "\t\t{ \"" + name + "\", " + numbers + ", stockTankRatio },\n";
+	}
+
+	out +=
+		"\t};\n"
+		"\n"
+		"\tinline constexpr auto stockTable = makeEngineTable(stockEngines);\n"
+		"};\n";
+
+	// through writeFile too, so an unchanged catalog doesn't touch the header and rebuild rock
+	return Dat::writeFile(path, vector<char>(out.begin(), out.end()));
+}
+
+vector<KSP::Engine> KSP::parseEngines(const char* data, size_t size) {
+	Dat::Layout layout;
+	if (!Dat::readLayout(data, size, engineMagic, engineVersion, sizeof(EngineRecord), layout)) return {};
+
+	vector<Engine> engines(layout.count);
+	const char* record = layout.records(data);
+
+	for (auto& engine : engines) {
+		string_view name;
+		if (!Dat::readName(data, layout, record, name)) return {};
+
+		engine.name = name;
+		engine.mass = Dat::get64(record + 8);
+		engine.vacIsp = Dat::get64(record + 16);
+		engine.atmIsp = Dat::get64(record + 24);
+		engine.vacThrust = Dat::get64(record + 32);
+		engine.atmThrust = Dat::get64(record + 40);
+
+		record += layout.recordSize;
+	}
+
+	return engines;
+}
+
+vector<KSP::Engine> KSP::loadEngines(const string& path) {
+	vector<char> data;
+	if (!Dat::readFile(path, data)) return {};
+
+	return parseEngines(data.data(), data.size());
+}
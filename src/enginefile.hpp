@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "catalog.hpp"
+#include "ksp.hpp"
+
+using namespace std;
+
+namespace KSP {
+	// One engine as it sits in engines.dat, see enginefile.cpp for the whole layout.
+	struct EngineRecord {
+		uint32_t nameOffset; // into the string table
+		uint32_t nameLength;
+
+		double mass;
+
+		double vacIsp;
+		double atmIsp;
+
+		double vacThrust;
+		double atmThrust;
+	};
+
+	static_assert(sizeof(EngineRecord) == 48, "EngineRecord has to match the file layout");
+
+	// engines.dat mapped read only into memory. Opening only checks the header, nothing is copied
+	// or parsed, so it takes the same time for any catalog size, and every process that maps the
+	// file shares the same pages. Records and names are views straight into the mapping, valid
+	// for as long as the EngineFile lives.
+	class EngineFile {
+	public:
+		EngineFile() = default;
+		EngineFile(const string& path); // empty if the file can't be mapped or isn't valid
+		~EngineFile();
+
+		EngineFile(EngineFile&& other) noexcept;
+		EngineFile& operator=(EngineFile&& other) noexcept;
+
+		EngineFile(const EngineFile&) = delete;
+		EngineFile& operator=(const EngineFile&) = delete;
+
+		size_t size() const { return count; }
+
+		const EngineRecord& record(size_t i) const { return *(const EngineRecord*)(records + i * stride); }
+		string_view name(size_t i) const; // empty if the record points outside the string table
+
+		Engine operator[](size_t i) const;
+
+	private:
+		const char* data = nullptr;
+		size_t bytes = 0;
+
+		const char* records = nullptr;
+		size_t count = 0;
+		size_t stride = 0;
+
+		const char* strings = nullptr;
+		size_t stringsSize = 0;
+	};
+
+	bool writeEngines(const string& path, const vector<Engine>& engines);
+	// constexpr stockEngines/stockTable (see catalog.hpp), budgeting `tankRatio` for the tanks like a loaded catalog would
+	bool writeEngineHeader(const string& path, const vector<Engine>& engines, double tankRatio = fuelRatio);
+	vector<Engine> parseEngines(const char* data, size_t size); // empty if the data isn't a valid catalog
+	vector<Engine> loadEngines(const string& path); // empty if the file can't be read or isn't valid
+};
@@ -0,0 +1,43 @@
+#include "job.hpp"
+
+using namespace std;
+using namespace KSP;
+
+void SolveJob::start(Solve solve) {
+	cancel();
+
+	progress = make_unique<Progress>();
+	finished = false;
+	startTime = chrono::steady_clock::now();
+
+	worker = thread([this, solve = move(solve), &progress = *progress] {
+		vector<Stage> rocket = solve(progress);
+		if (!progress.cancelled) progress.set(move(rocket));
+
+		finishTime = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+		finished = true;
+	});
+}
+
+void SolveJob::cancel() {
+	if (progress) progress->cancelled = true;
+	if (worker.joinable()) worker.join();
+}
+
+float SolveJob::fraction() const {
+	if (!progress) return 0.0f;
+	if (finished) return 1.0f;
+
+	const size_t total = progress->total;
+	return total ? (float)progress->done / total : 0.0f;
+}
+
+double SolveJob::elapsed() const {
+	if (finished) return finishTime;
+
+	return chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+}
+
+vector<Stage> SolveJob::best() const {
+	return progress ? progress->best() : vector<Stage>{};
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "solver.hpp"
+
+using namespace std;
+
+// A solve running on its own thread, so the GUI keeps drawing while it works. Starting another
+// solve, cancelling, or destroying the job stops whatever was running first.
+class SolveJob {
+public:
+	using Solve = function<vector<KSP::Stage>(KSP::Progress&)>;
+
+	~SolveJob() { cancel(); }
+
+	void start(Solve solve);
+	void cancel();
+
+	bool running() const { return progress && !finished; }
+	bool started() const { return progress != nullptr; }
+	bool cancelled() const { return progress && progress->cancelled; }
+
+	float fraction() const;
+	double elapsed() const; // ms, frozen once the job finishes
+	vector<KSP::Stage> best() const; // best so far while running, the answer once finished
+	vector<vector<KSP::Stage>> front() const { return progress ? progress->front() : vector<vector<KSP::Stage>>{}; }
+
+	size_t candidates() const { return progress ? progress->candidates.load() : 0; }
+	size_t pruned() const { return progress ? progress->pruned.load() : 0; }
+
+private:
+	thread worker;
+	unique_ptr<KSP::Progress> progress;
+
+	atomic<bool> finished = false;
+	chrono::steady_clock::time_point startTime;
+	atomic<double> finishTime = 0.0;
+};
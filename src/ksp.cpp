@@ -1,6 +1,5 @@
 #include <numeric>
 #include <cmath>
-#include <iostream>
 
 #include "ksp.hpp"
 
@@ -8,25 +7,8 @@
 
 using namespace std;
 
-// Engine
-
-ostream& operator<<(ostream& os, const KSP::Engine& engine) {
-	os.write(engine.name.c_str(), engine.name.size() + 1);
-	os.write((char*)&engine.mass, sizeof(engine) - sizeof(engine.name));
-
-	return os;
-}
-
-istream& operator>>(istream& is, KSP::Engine& engine) {
-	getline(is, engine.name, '\0'); // read null terminated string
-
-	is.read((char*)&engine.mass, sizeof(engine) - sizeof(engine.name));
-
-	return is;
-}
-
 // Args
 
-KSP::Args KSP::MultiArgs::toArgs(int i) {
-	return KSP::Args{payload, deltaV, gravity, atm[atm.size() - 1 - i], twr[twr.size() - 1 - i]};
-}
\ No newline at end of file
+KSP::Args KSP::MultiArgs::toArgs(int i) const {
+	return KSP::Args{payload, deltaV, gravity, atm[atm.size() - 1 - i], twr[twr.size() - 1 - i], maxEngines, decouplerMass};
+}
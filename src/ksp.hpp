@@ -1,4 +1,8 @@
+#pragma once
+
+#include <cstdint>
 #include <string>
+#include <utility>
 #include <vector>
 #include <cmath>
 
@@ -29,6 +33,10 @@ namespace KSP {
 
 		double atm;
 		double twr;
+
+		int maxEngines = 9; // most engines a single stage may use
+
+		double decouplerMass = 0.0; // dropped along with the stage's empty tanks
 	};
 
 	struct MultiArgs {
@@ -41,16 +49,39 @@ namespace KSP {
 		vector<double> atm;
 		vector<double> twr;
 
-		Args toArgs(int i = 0);
+		int maxEngines = 9;
+
+		double decouplerMass = 0.0; // every stage carries one
+
+		Args toArgs(int i = 0) const;
+
+		bool operator==(const MultiArgs&) const = default;
 	};
 
 	struct Stage {
 		Engine engine;
-		int count;
+		int count = 0; // 0 when no engine can fly the stage
 
-		double mass;
+		double mass = __DBL_MAX__;
+
+		vector<pair<int, int>> tanks; // real tanks as (index into PartCatalog::tanks, count), empty when fuel is continuous
+
+		bool feasible() const { return count > 0; }
 	};
-};
 
-ostream& operator<<(ostream& os, const KSP::Engine& engine);
-istream& operator>>(istream& is, KSP::Engine& engine);
\ No newline at end of file
+	// A stage the way the solvers pass it around: the engine is a row of the EngineTable it came
+	// from and there's no tank list, so it copies like the handful of numbers it is. Only a
+	// finished rocket gets turned back into Stages, see SolveContext::rocket.
+	struct StagePick {
+		uint32_t engine = 0;
+		int count = 0;
+
+		double mass = __DBL_MAX__;
+
+		// what a real tank stack was solved for, enough to ask the TankSolver for it again
+		double R = 0.0;
+		double fixedMass = 0.0;
+
+		bool feasible() const { return count > 0; }
+	};
+};
\ No newline at end of file
@@ -3,15 +3,26 @@
 #include <iostream>
 #include <fstream>
 #include <numeric>
-#include <execution>
+#include <thread>
 #include <cmath>
 #include <random>
+#include <cstdlib>
+#include <filesystem>
 #include <GLFW/glfw3.h>
 
 #include "imgui/imgui.h"
 #include "imgui/imgui_impl_glfw.h"
 #include "imgui/imgui_impl_opengl3.h"
 #include "ksp.hpp"
+#include "solver.hpp"
+#include "pareto.hpp"
+#include "job.hpp"
+#include "reload.hpp"
+#include "batch.hpp"
+#include "serve.hpp"
+#include "atlas.hpp"
+#include "ascent.hpp"
+#include "bodies.hpp"
 
 using namespace std;
 using namespace KSP;
@@ -20,112 +31,97 @@ random_device dev;
 mt19937 rng(dev());
 uniform_real_distribution<double> frand(0, 1);
 
-const pair<const char*, double> planets[17] = {
-	{"None", 0},
-	{"Moho", 2.70},
-	{"Eve", 16.7},
-	{"Gilly", 0.049},
-	{"Kerbin", 9.81},
-	{"Mun", 1.63},
-	{"Minmus", 0.491},
-	{"Duna", 2.94},
-	{"Ike", 1.10},
-	{"Dres", 1.13},
-	{"Jool", 7.85},
-	{"Laythe", 7.85},
-	{"Vall", 2.31},
-	{"Tylo", 7.85},
-	{"Bop", 0.589},
-	{"Pol", 0.373},
-	{"Eeloo", 1.69}
-};
-
-vector<Engine> engines;
-
-const Engine nerv{ "LV-N \"Nerv\" Atomic Rocket Motor", 3.0, 800.0, 185.0, 60.00, 13.88 };
-constexpr double nervRatio = 1.0 / 9.0;
-
-constexpr double fuelRatio = 0.125;
-
-Stage findOptimalStage(Args args) {
-
-	double bestMass = __DBL_MAX__;
-
-	Stage bestStage;
-
-	for (const auto& engine : engines) {
-		const double R = exp(args.deltaV / (engine.isp(args.atm) * 9.81));
-		for (int i = 1; i <= 9; i++) { // FANCY rocket equation solving for fuel mass
-			const double payload = engine.mass * i + args.payload;
-			const double fuelMass = (R - 1) * payload / (fuelRatio + 1.0 - R * fuelRatio);
-			const double totalMass = (fuelRatio + 1.0) * fuelMass + payload;
-
-			if (i * engine.thrust(args.atm) / (totalMass * args.gravity) < args.twr) continue;
-
-			if (totalMass < bestMass) {
-				bestMass = totalMass;
-				bestStage = Stage{ engine, i, totalMass };
-			}
-
-			break;
-		}
+int main(int argc, char** argv) {
+	// a catalog on disk overrides the one built in, so modded parts work without a rebuild
+	string enginePath = "partdata/engines.dat";
+
+	// rock --batch missions.jsonl [--out results.jsonl] [--solver exact|sweep|split] [--threads n]
+	// solves a whole file without opening a window, see batch.hpp, and rock --serve rock.sock
+	// [--solver ...] [--threads n] answers requests on a socket instead, see serve.hpp. Both keep
+	// finished rockets in a SolutionCache given --solutions file, the window always does.
+	// rock --build-atlas atlas.dat [--solver ...] [--threads n] solves a whole grid of missions
+	// ahead of time and rock --atlas atlas.dat [--max-error e] answers lookups into it from stdin,
+	// solving the ones in cells measured worse than e, see atlas.hpp.
+	string batchPath, servePath, solver, solutionsPath, buildAtlasPath, atlasPath;
+	BatchOptions batch;
+	batch.threads = max(thread::hardware_concurrency(), 1u);
+	double maxError = __DBL_MAX__;
+
+	for (int i = 1; i < argc; i++) {
+		const string arg = argv[i];
+		if (i + 1 >= argc) break;
+
+		if (arg == "--engines") enginePath = argv[++i];
+		else if (arg == "--batch") batchPath = argv[++i];
+		else if (arg == "--serve") servePath = argv[++i];
+		else if (arg == "--out") batch.output = argv[++i];
+		else if (arg == "--threads") batch.threads = max(atoi(argv[++i]), 1);
+		else if (arg == "--solver") solver = argv[++i];
+		else if (arg == "--solutions") solutionsPath = argv[++i];
+		else if (arg == "--build-atlas") buildAtlasPath = argv[++i];
+		else if (arg == "--atlas") atlasPath = argv[++i];
+		else if (arg == "--max-error") maxError = max(atof(argv[++i]), 0.0);
 	}
 
-	// nerv time baby
+	if (!batchPath.empty()) {
+		if (!solver.empty()) batch.solver = batchSolver(solver);
+		batch.solutions = solutionsPath;
+		return runBatch(batchPath, *loadCatalog(enginePath, "partdata"), batch);
+	}
 
-	const double R = exp(args.deltaV / (nerv.isp(args.atm) * 9.81));
-	for (int i = 1; i <= 9; i++) {
-		const double payload = nerv.mass * i + args.payload;
-		const double fuelMass = (R - 1) * payload / (nervRatio + 1.0 - R * nervRatio);
-		const double totalMass = (nervRatio + 1.0) * fuelMass + payload;
+	if (!buildAtlasPath.empty()) {
+		AtlasSpec spec;
+		if (!solver.empty()) spec.solver = batchSolver(solver);
+		return buildAtlas(buildAtlasPath, *loadCatalog(enginePath, "partdata"), spec, batch.threads) ? 0 : 1;
+	}
 
-		if (i * nerv.thrust(args.atm) / (totalMass * args.gravity) < args.twr) continue;
+	if (!atlasPath.empty()) return runAtlasQueries(atlasPath, *loadCatalog(enginePath, "partdata"), maxError);
 
-		if (totalMass < bestMass) {
-			return Stage{ nerv, i, totalMass };
-		}
+	if (!servePath.empty()) {
+		ServeOptions serve{ enginePath, solutionsPath };
+		if (!solver.empty()) serve.solver = batchSolver(solver);
+		serve.threads = batch.threads;
+		return runServer(servePath, serve);
 	}
 
+	// rebuilt whenever the serializer writes new files, without losing anything typed in
+	CatalogWatcher watcher(enginePath, "partdata");
+	shared_ptr<const Catalog> catalog = watcher.current();
+	size_t generation = watcher.generation();
 
-	return bestStage;
-}
+	MultiArgs args{ 10.0, 3400.0, 9.81, 2, {1, 0.5}, {1.2, 0.8} };
+	vector<double> altitudes{ 0.0, 30.0 }; // km where each stage lights, bottom first like args.atm
 
-vector<Stage> findRandomMulti(MultiArgs args, double frac) {
-	vector<Stage> solution;
+	SolveJob job;
+	SolutionKey jobKey{}; // what the job is solving and how, so a reload can solve it again
+	int jobThreads = 0;
+	bool jobCached = false; // through the stage cache
+	shared_ptr<const Catalog> jobCatalog = catalog; // and what it's solving with, its stages index into it
+	int jobBody = -1; // and where it launches from, -1 for a gravity that isn't any body's
 
-	while (args.stageCount > 1) {
-		Args firstArgs = args.toArgs();
-		firstArgs.deltaV = args.deltaV * frac;
+	// the finished job's answer with its rockets flown off jobBody, worked out once rather than every frame
+	bool jobScored = false; // false while it runs, and again whenever it or what it solves changes
+	vector<Stage> jobBest;
+	vector<vector<Stage>> jobFront;
+	vector<AscentScore> bestAscent, frontAscents; // empty unless it launches from a body
 
-		solution.push_back(findOptimalStage(firstArgs));
+	int selectedDecoupler = -1;
+	int selectedBody = findBody("Kerbin");
 
-		// prepare next args
-		args.deltaV -= firstArgs.deltaV;
-		args.atm.pop_back();
-		args.twr.pop_back();
-		args.payload = solution.back().mass;
-		args.stageCount -= 1;
-	}
-	solution.push_back(findOptimalStage(args.toArgs()));
 
-	return solution;
-}
+	const int maxIter = 1000;
+	const int paretoIter = 200;
 
-int main(int argc, char** argv) {
-	ifstream engineFile("partdata/engines.dat");
+	const size_t cacheCapacity = 1 << 18;
+	shared_ptr<StageCache> stageCache = make_shared<StageCache>(cacheCapacity);
 
-	Engine temp;
-	while (engineFile.peek() != EOF) {
-		engineFile >> temp;
-		engines.push_back(temp);
+	// whatever was solved in earlier sessions, for as long as the catalog stays the same
+	if (solutionsPath.empty()) {
+		solutionsPath = "partdata/cache/solutions.dat";
+		error_code ignored;
+		filesystem::create_directories("partdata/cache", ignored);
 	}
-
-	MultiArgs args{ 10.0, 3400.0, 9.81, 2, {1, 0.5}, {1.2, 0.8} };
-
-	vector<Stage> best = {};
-
-
-	const int maxIter = 1000;
+	shared_ptr<SolutionCache> solutions = make_shared<SolutionCache>(solutionsPath, catalog->hash);
 
 
 
@@ -174,6 +170,35 @@ int main(int argc, char** argv) {
 		ImGui_ImplGlfw_NewFrame();
 		ImGui::NewFrame();
 
+		// a new catalog takes over from here, a solve still running finishes on the one it started with
+		bool reloaded = false;
+		bool jobDecouplerChanged = false;
+		if (watcher.generation() != generation) {
+			generation = watcher.generation();
+			shared_ptr<const Catalog> next = watcher.current();
+
+			// the decoupler is kept by name, its index and mass may both have changed
+			if (selectedDecoupler >= 0) {
+				const double was = args.decouplerMass;
+				const PartRef* ref = next->parts.find(catalog->parts.decouplers[selectedDecoupler].name);
+				selectedDecoupler = ref && ref->type == PartType::Decoupler ? (int)ref->index : -1;
+				args.decouplerMass = selectedDecoupler >= 0 ? next->parts.decouplers[selectedDecoupler].mass : 0.0;
+
+				// and the job's mission gets it too if it was flying the same one
+				if (jobKey.args.decouplerMass == was && args.decouplerMass != was) {
+					jobKey.args.decouplerMass = args.decouplerMass;
+					jobDecouplerChanged = true;
+					jobScored = false;
+				}
+			}
+
+			// cached stages name engines from the old catalog
+			catalog = move(next);
+			stageCache = make_shared<StageCache>(cacheCapacity, stageCache->quantum());
+			solutions = make_shared<SolutionCache>(solutionsPath, catalog->hash);
+			reloaded = true;
+		}
+
 		{
 			static float f = 0.0f;
 			static int counter = 0;
@@ -188,15 +213,33 @@ int main(int argc, char** argv) {
 			if (ImGui::InputInt("Stage Count", &args.stageCount, 1, 0)) {
 				args.atm.resize(args.stageCount);
 				args.twr.resize(args.stageCount);
+				altitudes.resize(args.stageCount, 30.0);
 			}
+			if (ImGui::InputInt("Max Engines per Stage", &args.maxEngines, 1, 8))
+				args.maxEngines = max(args.maxEngines, 1);
 
 			ImGui::InputDouble("Gravity, m/s^2", &args.gravity, 1.0, 10.0, "%.2f");
-			static int selectedPlanet = 4;
-			if (ImGui::BeginCombo("Planet(used for TWR)", planets[selectedPlanet].first)) {
-				for (size_t i = 0; i < IM_ARRAYSIZE(planets); i++) {
-					if (ImGui::Selectable(planets[i].first, false)) {
-						selectedPlanet = i;
-						args.gravity = planets[i].second;
+			if (ImGui::BeginCombo("Planet(used for TWR)", bodies[selectedBody].name)) {
+				for (size_t i = 0; i < IM_ARRAYSIZE(bodies); i++) {
+					if (ImGui::Selectable(bodies[i].name, false)) {
+						selectedBody = i;
+						args.gravity = bodies[i].gravity;
+					}
+				}
+				ImGui::EndCombo();
+			}
+			const Body& body = bodies[selectedBody];
+
+			const PartCatalog& parts = catalog->parts;
+			if (!parts.decouplers.empty() && ImGui::BeginCombo("Decoupler", selectedDecoupler < 0 ? "None" : parts.decouplers[selectedDecoupler].name.c_str())) {
+				if (ImGui::Selectable("None", selectedDecoupler < 0)) {
+					selectedDecoupler = -1;
+					args.decouplerMass = 0.0;
+				}
+				for (size_t i = 0; i < parts.decouplers.size(); i++) {
+					if (ImGui::Selectable(parts.decouplers[i].name.c_str(), selectedDecoupler == (int)i)) {
+						selectedDecoupler = i;
+						args.decouplerMass = parts.decouplers[i].mass;
 					}
 				}
 				ImGui::EndCombo();
@@ -207,13 +250,27 @@ int main(int argc, char** argv) {
 			ImGui::NewLine();
 			ImGui::Text("Per stage settings:");
 
+			// the pressure each stage burns in, looked up on the planet's curve
+			static bool enterAltitudes = false;
+			ImGui::Checkbox("Enter start altitudes", &enterAltitudes);
+
 			ImGui::PushItemWidth(100);
 			for (size_t i = 0; i < args.stageCount; i++) {
 				ImGui::PushID(i);
 
 				ImGui::Text("Stage %lu:", i + 1); ImGui::SameLine();
-				ImGui::Text("Pressure, atm: "); ImGui::SameLine();
-				ImGui::InputDouble("##ATM", &args.atm[args.atm.size() - i - 1], 0.1, 1, "%.2f"); ImGui::SameLine();
+				if (enterAltitudes) {
+					double& altitude = altitudes[altitudes.size() - i - 1];
+					ImGui::Text("Altitude, km: "); ImGui::SameLine();
+					if (ImGui::InputDouble("##ALT", &altitude, 1, 10, "%.1f")) altitude = max(altitude, 0.0);
+					ImGui::SameLine();
+
+					args.atm[args.atm.size() - i - 1] = body.pressure(altitude * 1000.0);
+					ImGui::TextDisabled("%.3f atm", args.atm[args.atm.size() - i - 1]); ImGui::SameLine();
+				} else {
+					ImGui::Text("Pressure, atm: "); ImGui::SameLine();
+					ImGui::InputDouble("##ATM", &args.atm[args.atm.size() - i - 1], 0.1, 1, "%.2f"); ImGui::SameLine();
+				}
 				ImGui::Text("TWR: "); ImGui::SameLine();
 				ImGui::InputDouble("##TWR", &args.twr[args.twr.size() - i - 1], 0.1, 1, "%.2f");
 
@@ -224,28 +281,201 @@ int main(int argc, char** argv) {
 
 
 			ImGui::NewLine();
-			ImGui::SetNextItemWidth(0);
-			if (ImGui::Button("Generate!", ImVec2{ImGui::GetContentRegionAvail().x, 0})) {
-				best = findRandomMulti(args, 0.5);
-
-				vector<Stage> rocket;
-				for (int i = 0; i < maxIter; i++) {
-					rocket = findRandomMulti(args, i / (double)maxIter);
-					
-					if (rocket.back().mass < best.back().mass) 
-						best = rocket;
+			ImGui::PushItemWidth(300);
+			static int solver = 1;
+			const char* solvers[] = { "Fraction sweep", "Exact (DP)", "Split search (Nelder-Mead)", "Trade-offs (Pareto front)" };
+			ImGui::Combo("Solver", &solver, solvers, IM_ARRAYSIZE(solvers));
+
+			static int dpBins = 200;
+			if (solver == 1 && ImGui::InputInt("Delta-v steps", &dpBins, 10, 100))
+				dpBins = max(dpBins, 1);
+
+			static int evaluations = 60;
+			if (solver == 2 && ImGui::InputInt("Evaluations per seed", &evaluations, 10, 50))
+				evaluations = max(evaluations, 8);
+
+			static int threads = max(thread::hardware_concurrency(), 1u);
+			if (ImGui::InputInt("Threads", &threads, 1, 4))
+				threads = max(threads, 1);
+
+			// cached stages were built one way or the other, so switching starts a fresh cache
+			static bool realTanks = false;
+			if (!catalog->tanks.empty() && ImGui::Checkbox("Build from real tanks", &realTanks))
+				stageCache = make_shared<StageCache>(cacheCapacity, stageCache->quantum());
+
+			static bool useCache = true;
+			static double quantum = stageCache->quantum();
+			ImGui::Checkbox("Cache stages", &useCache);
+			if (useCache) {
+				ImGui::SameLine();
+				ImGui::SetNextItemWidth(150);
+				// a new grid makes every old entry useless, so start a fresh cache
+				if (ImGui::InputDouble("Grid", &quantum, 0.001, 0.01, "%.4f")) {
+					quantum = max(quantum, 0.0);
+					stageCache = make_shared<StageCache>(cacheCapacity, quantum);
 				}
 			}
+			ImGui::PopItemWidth();
+
+			// everything a result depends on, filed the same way the solution cache files it
+			const bool tanks = realTanks && !catalog->tanks.empty();
+			const uint32_t parameter = solver == 1 ? dpBins : solver == 2 ? evaluations : solver == 3 ? paretoIter : maxIter;
+			const SolutionKey settings{ args, (uint32_t)solver, parameter, useCache ? stageCache->quantum() : 0.0, tanks };
+
+			// solves `key` on the current catalog and caches, the parameter being the solver's own
+			auto startJob = [&](SolutionKey key, int threads, bool cached, int body) {
+				key.tanks = key.tanks && !catalog->tanks.empty();
+				jobKey = key;
+				jobThreads = threads;
+				jobCached = cached;
+				jobCatalog = catalog;
+				jobBody = body;
+				jobScored = false;
+
+				shared_ptr<StageCache> cache = cached ? stageCache : nullptr;
+				job.start([key, threads, cache, body, catalog = catalog, solutions = solutions](Progress& progress) {
+					const SolveContext context{ catalog->engines, threads, &progress, cache.get(), key.tanks ? &catalog->tanks : nullptr };
+
+					// a trade-off front is more than the one rocket kept per key, so it's always solved
+					if (key.solver == 3) {
+						const vector<vector<Stage>> front = findParetoMulti(context, key.args, key.parameter);
+						if (progress.cancelled || body < 0 || !(bodies[body].gravity > 0.0)) return progress.best();
+
+						// the front flown off the body picks the answer: the lightest rocket that gets the whole
+						// delta-v out of its engines at the pressures they really burn in, else the lightest that
+						// at least lifts off, rather than the lightest going by the atm guesses
+						const vector<AscentScore> ascents = scoreAscents(bodies[body], catalog->altitudes[body], catalog->engines, catalog->parts.tanks, key.args, front);
+						const vector<Stage>* lightest[2] = {}; // delivers everything, only lifts off
+						for (size_t i = 0; i < front.size(); i++) {
+							if (ascents[i].crashed) continue;
+
+							const vector<Stage>*& pick = lightest[ascents[i].deltaV >= key.args.deltaV ? 0 : 1];
+							if (!pick || front[i].back().mass < pick->back().mass) pick = &front[i];
+						}
+
+						const vector<Stage>* pick = lightest[0] ? lightest[0] : lightest[1];
+						return pick ? *pick : progress.best();
+					}
+
+					vector<Stage> rocket;
+					if (solutions->find(key, rocket)) return rocket;
+
+					if (key.solver == 1) rocket = findOptimalMulti(context, key.args, key.parameter);
+					else if (key.solver == 2) rocket = optimizeSplitMulti(context, key.args, key.parameter);
+					else rocket = sweepMulti(context, key.args, key.parameter);
+
+					// a cancelled solve only got partway
+					if (!progress.cancelled) solutions->insert(key, rocket);
+					return rocket;
+				});
+			};
+
+			ImGui::SetNextItemWidth(0);
+			const bool generate = ImGui::Button("Generate!", ImVec2{ImGui::GetContentRegionAvail().x, 0});
+			if (generate) startJob(settings, threads, useCache, args.gravity == body.gravity ? selectedBody : -1);
+
+			// after a reload whatever was solved last is solved again as it was asked for, but only
+			// when it was still going or the new parts change something it's built from
+			if (!generate && reloaded && job.started() && !job.cancelled()) {
+				vector<vector<Stage>> rockets = job.front();
+				rockets.push_back(job.best());
+				if (job.running() || jobDecouplerChanged || !sameParts(*jobCatalog, *catalog, rockets))
+					startJob(jobKey, jobThreads, jobCached, jobBody);
+			}
+
+			// whatever is running was solving for different inputs or settings, it's no use anymore
+			static SolutionKey shownSettings = settings;
+			static int shownThreads = threads;
+			if (job.running() && (settings != shownSettings || threads != shownThreads)) job.cancel();
+			shownSettings = settings;
+			shownThreads = threads;
 
 			ImGui::End();
 
 
 			ImGui::Begin("Results", nullptr, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoMove);
 
+			if (job.running()) {
+				ImGui::ProgressBar(job.fraction(), ImVec2{ImGui::GetContentRegionAvail().x, 0});
+				if (ImGui::Button("Cancel", ImVec2{ImGui::GetContentRegionAvail().x, 0})) job.cancel();
+			}
+
+			// launches from a body get flown off it, through its air if it has any, the atm guesses only go so far
+			const bool fromBody = jobBody >= 0 && bodies[jobBody].gravity > 0.0;
+			if (job.started() && !job.running() && !jobScored) {
+				jobBest = job.best();
+				jobFront = job.front();
+
+				const bool flies = !jobBest.empty() && jobBest.back().feasible();
+				bestAscent = fromBody && flies ? scoreAscents(bodies[jobBody], jobCatalog->altitudes[jobBody], jobCatalog->engines, jobCatalog->parts.tanks, jobKey.args, span(&jobBest, 1)) : vector<AscentScore>{};
+				// the whole front flown in one batch
+				frontAscents = fromBody ? scoreAscents(bodies[jobBody], jobCatalog->altitudes[jobBody], jobCatalog->engines, jobCatalog->parts.tanks, jobKey.args, jobFront) : vector<AscentScore>{};
+				jobScored = true;
+			}
+
+			const vector<Stage> best = jobScored ? jobBest : job.best();
 			for (const auto& stage : best) {
 				ImGui::Text("%s x %i: %.2ft", stage.engine.name.c_str(), stage.count, stage.mass);
+				for (const auto& [tank, count] : stage.tanks)
+					ImGui::BulletText("%s x %i", jobCatalog->parts.tanks[tank].name.c_str(), count);
+			}
+
+			if (jobScored && !bestAscent.empty()) {
+				const AscentScore& ascent = bestAscent[0];
+				if (ascent.crashed) ImGui::TextDisabled("Ascent from %s: doesn't get off the ground", bodies[jobBody].name);
+				else ImGui::TextDisabled("Ascent from %s: %.0f m/s lost to gravity, %.0f to drag", bodies[jobBody].name, ascent.gravityLoss, ascent.dragLoss);
+			}
+
+			const vector<vector<Stage>> front = jobScored ? jobFront : job.front();
+			if (!front.empty()) {
+				ImGui::NewLine();
+				ImGui::Text("Trade-offs:");
+
+				const bool scored = jobScored && fromBody;
+
+				if (ImGui::BeginTable("Pareto", scored ? 5 : 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY | ImGuiTableFlags_SizingFixedFit, ImVec2{0, 200})) {
+					ImGui::TableSetupColumn("Stages");
+					ImGui::TableSetupColumn("Engines");
+					ImGui::TableSetupColumn("Mass, t");
+					if (scored) ImGui::TableSetupColumn("Ascent losses, m/s");
+					ImGui::TableSetupColumn("Rocket", ImGuiTableColumnFlags_WidthStretch);
+					ImGui::TableHeadersRow();
+
+					for (size_t i = 0; i < front.size(); i++) {
+						const auto& rocket = front[i];
+						ImGui::TableNextRow();
+						ImGui::TableNextColumn(); ImGui::Text("%zu", rocket.size());
+						ImGui::TableNextColumn(); ImGui::Text("%i", engineCount(rocket));
+						ImGui::TableNextColumn(); ImGui::Text("%.2f", rocket.back().mass);
+						if (scored) {
+							ImGui::TableNextColumn();
+							if (frontAscents[i].crashed) ImGui::Text("can't lift off");
+							else ImGui::Text("%.0f", frontAscents[i].gravityLoss + frontAscents[i].dragLoss);
+						}
+
+						ImGui::TableNextColumn();
+						for (const auto& stage : rocket) {
+							ImGui::Text("%s x %i", stage.engine.name.c_str(), stage.count);
+						}
+					}
+
+					ImGui::EndTable();
+				}
 			}
 
+			if (job.started() && !job.running()) {
+				if (!job.cancelled() && best.empty())
+					ImGui::Text("No rocket can fly this mission, try more engines per stage or a lower TWR.");
+
+				ImGui::TextDisabled(job.cancelled() ? "Cancelled after %.1f ms" : "Solved in %.1f ms", job.elapsed());
+			}
+
+			if (job.candidates())
+				ImGui::TextDisabled("Pruned %zu of %zu engine candidates", job.pruned(), job.candidates());
+			ImGui::TextDisabled("Stage cache: %zu hits, %zu misses", stageCache->hits(), stageCache->misses());
+			if (solutions->valid()) ImGui::TextDisabled("Solution cache: %zu rockets, %zu hits", solutions->size(), solutions->hits());
+			ImGui::TextDisabled(generation ? "Catalog: %zu engines, reloaded %zu times" : "Catalog: %zu engines", catalog->engines.size(), generation);
+
 			ImGui::End();
 		}
 
@@ -261,6 +491,8 @@ int main(int argc, char** argv) {
 	}
 
 	// Cleanup
+	job.cancel();
+
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
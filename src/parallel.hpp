@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Calls body(i, worker) for every i in [0, count) on up to `threads` workers, the calling thread
+// being worker 0. Indices are handed out in chunks off a shared counter so a slow chunk never
+// holds the others up, and every worker sees its own indices in increasing order.
+template<class Body>
+void parallelFor(size_t count, int threads, Body&& body, size_t chunk = 8) {
+	threads = (int)clamp<size_t>(threads, 1, max<size_t>((count + chunk - 1) / chunk, 1));
+
+	atomic<size_t> next = 0;
+	auto work = [&](int worker) {
+		for (size_t begin; (begin = next.fetch_add(chunk)) < count;) {
+			const size_t end = min(begin + chunk, count);
+			for (size_t i = begin; i < end; i++) body(i, worker);
+		}
+	};
+
+	vector<thread> pool;
+	for (int worker = 1; worker < threads; worker++) pool.emplace_back(work, worker);
+	work(0);
+
+	for (auto& t : pool) t.join();
+}
+
+// parallelFor on threads that stay up between calls, for callers going round many small batches
+// (a server's rounds) where starting threads every time would cost more than the work itself.
+// The calling thread is worker 0 here too, so `threads` workers means threads - 1 in the pool.
+// run() is for one caller at a time.
+class WorkerPool {
+public:
+	explicit WorkerPool(int threads) {
+		for (int worker = 1; worker < threads; worker++) pool.emplace_back([this, worker] { wait(worker); });
+	}
+
+	~WorkerPool() {
+		{
+			lock_guard guard(lock);
+			stopping = true;
+		}
+		wake.notify_all();
+
+		for (auto& t : pool) t.join();
+	}
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	int size() const { return (int)pool.size() + 1; }
+
+	template<class Body>
+	void run(size_t count, Body&& body, size_t chunk = 8) {
+		// not worth waking anyone for a single chunk
+		if (pool.empty() || count <= chunk) {
+			for (size_t i = 0; i < count; i++) body(i, 0);
+			return;
+		}
+
+		{
+			lock_guard guard(lock);
+			batch = { count, chunk, &body, [](void* body, size_t i, int worker) { (*(Body*)body)(i, worker); } };
+			next = 0;
+			busy = pool.size();
+			generation++;
+		}
+		wake.notify_all();
+
+		work(0);
+
+		unique_lock guard(lock);
+		done.wait(guard, [&] { return busy == 0; });
+	}
+
+private:
+	struct Batch {
+		size_t count, chunk;
+		void* body;
+		void (*call)(void* body, size_t i, int worker);
+	};
+
+	void work(int worker) {
+		for (size_t begin; (begin = next.fetch_add(batch.chunk)) < batch.count;) {
+			const size_t end = min(begin + batch.chunk, batch.count);
+			for (size_t i = begin; i < end; i++) batch.call(batch.body, i, worker);
+		}
+	}
+
+	void wait(int worker) {
+		for (size_t seen = 0;;) {
+			{
+				unique_lock guard(lock);
+				wake.wait(guard, [&] { return stopping || generation != seen; });
+				if (stopping) return;
+				seen = generation;
+			}
+
+			work(worker);
+
+			lock_guard guard(lock);
+			if (--busy == 0) done.notify_one();
+		}
+	}
+
+	vector<thread> pool;
+
+	mutex lock;
+	condition_variable wake, done;
+	size_t generation = 0; // bumped for every batch
+	size_t busy = 0; // pool threads still on the current batch
+	bool stopping = false;
+
+	Batch batch{};
+	atomic<size_t> next = 0;
+};
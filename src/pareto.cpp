@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <mutex>
+
+#include "pareto.hpp"
+#include "parallel.hpp"
+
+using namespace std;
+using namespace KSP;
+
+int KSP::engineCount(const vector<Stage>& rocket) {
+	int count = 0;
+	for (const auto& stage : rocket) count += stage.count;
+
+	return count;
+}
+
+// ParetoArchive
+
+KSP::ParetoArchive::ParetoArchive(SolveArena& arena, span<const size_t> capacities) {
+	fronts = arena.take<Front>(capacities.size());
+	for (size_t k = 0; k < capacities.size(); k++) fronts[k] = { arena.take<Entry>(capacities[k]), 0 };
+}
+
+bool KSP::ParetoArchive::insert(span<const StagePick> rocket, double mass, int engines) {
+	const size_t stages = rocket.size();
+	if (stages == 0 || stages > fronts.size()) return false;
+
+	auto byMass = [](const Entry& a, double mass) { return a.mass < mass; };
+
+	// anything with no more stages, no more mass and no more engines beats it, and the entry
+	// with the fewest engines among those no heavier is the last one at or under its mass
+	for (size_t k = 0; k < stages; k++) {
+		const span<const Entry> front = fronts[k].entries.first(fronts[k].size);
+		auto heavier = upper_bound(front.begin(), front.end(), mass, [](double mass, const Entry& e) { return mass < e.mass; });
+		if (heavier != front.begin() && prev(heavier)->engines <= engines) return false;
+	}
+
+	// and it beats whatever has at least as many stages, mass and engines, which in each
+	// front is a run starting at its mass
+	for (size_t k = stages - 1; k < fronts.size(); k++) {
+		Front& front = fronts[k];
+		const auto end = front.entries.begin() + front.size;
+		const auto first = lower_bound(front.entries.begin(), end, mass, byMass);
+		auto last = first;
+		while (last != end && last->engines >= engines) last++;
+
+		front.size = copy(last, end, first) - front.entries.begin();
+	}
+
+	// fronts are only ever as big as what was inserted into them, which their room was made for
+	Front& front = fronts[stages - 1];
+	if (front.size == front.entries.size()) return false;
+
+	const auto end = front.entries.begin() + front.size;
+	const auto at = lower_bound(front.entries.begin(), end, mass, byMass);
+	copy_backward(at, end, end + 1);
+	*at = Entry{ mass, engines, rocket };
+	front.size++;
+
+	return true;
+}
+
+vector<vector<Stage>> KSP::ParetoArchive::rockets(const SolveContext& context) const {
+	vector<vector<Stage>> result;
+	result.reserve(size());
+	for (const auto& front : fronts)
+		for (const auto& entry : front.entries.first(front.size)) result.push_back(context.rocket(entry.rocket));
+
+	return result;
+}
+
+size_t KSP::ParetoArchive::size() const {
+	size_t total = 0;
+	for (const auto& front : fronts) total += front.size;
+
+	return total;
+}
+
+// Search
+
+namespace {
+	// a partial rocket, one stage under its parent (-1 above the top stage)
+	struct Node {
+		double mass;
+		int engines;
+		int parent;
+
+		StagePick stage;
+	};
+
+	// one finished rocket, its stages out of the arena
+	struct Candidate {
+		double mass;
+		int engines;
+
+		span<const StagePick> rocket; // turned into Stages only once it's on the front
+	};
+
+	// what one thread builds its stacks in, kept so a thread that solves again stays off the heap
+	struct Scratch {
+		vector<Node> nodes;
+		vector<int> labels, next;
+		vector<StagePick> options;
+	};
+
+	// partial rockets built from the top down, kept only while no other one is both lighter and
+	// uses fewer engines, since a lighter stack never needs more below it. A `stages` rocket uses
+	// the settings of the bottom `stages` in `args`. Leaves the survivors' nodes in scratch.labels,
+	// none when no stack flies.
+	void stackStages(const SolveContext& context, const MultiArgs& args, int stages, double frac, Scratch& scratch) {
+		auto& nodes = scratch.nodes;
+		auto& labels = scratch.labels;
+		auto& next = scratch.next;
+
+		nodes.assign(1, Node{ args.payload, 0, -1, {} });
+		labels.assign(1, 0);
+
+		double deltaV = args.deltaV;
+		for (int k = 0; k < stages; k++) {
+			Args stageArgs = args.toArgs(args.stageCount - stages + k);
+			stageArgs.deltaV = k < stages - 1 ? deltaV * frac : deltaV;
+
+			next.clear();
+			for (int label : labels) {
+				const Node parent = nodes[label]; // a copy, growing nodes moves it
+				stageArgs.payload = parent.mass;
+
+				context.stageOptions(stageArgs, scratch.options);
+				for (const auto& option : scratch.options) {
+					nodes.push_back(Node{ option.mass, parent.engines + option.count, label, option });
+					next.push_back(nodes.size() - 1);
+				}
+			}
+
+			// nodes go in in order, so ties going by index keep it stable
+			sort(next.begin(), next.end(), [&](int a, int b) { return tie(nodes[a].mass, a) < tie(nodes[b].mass, b); });
+
+			labels.clear();
+			for (int node : next)
+				if (labels.empty() || nodes[node].engines < nodes[labels.back()].engines) labels.push_back(node);
+
+			if (labels.empty()) break;
+
+			deltaV -= stageArgs.deltaV;
+		}
+	}
+};
+
+ParetoArchive findParetoPicks(const SolveContext& context, const MultiArgs& args, int iterations) {
+	Progress* progress = context.progress;
+
+	if (!context.arena) return {}; // the archive lives in it
+	SolveArena& arena = *context.arena;
+	arena.reset();
+
+	// one task per (stage count, fraction), a single stage rocket has no split to try
+	struct Task {
+		int stages;
+		double frac;
+	};
+	const size_t taskCount = args.stageCount > 0 ? 1 + (args.stageCount - 1) * (size_t)max(iterations, 0) : 0;
+	span<Task> tasks = arena.take<Task>(taskCount);
+	for (int stages = 1, t = 0; stages <= args.stageCount; stages++) {
+		if (stages == 1) tasks[t++] = { 1, 1.0 };
+		else for (int i = 0; i < iterations; i++) tasks[t++] = { stages, i / (double)iterations };
+	}
+	if (progress) progress->total = tasks.size();
+
+	// every thread's survivors get copied into the arena as they finish, which is the only
+	// thing the threads share
+	span<span<Candidate>> found = arena.take<span<Candidate>>(tasks.size());
+	mutex foundLock;
+
+	parallelFor(tasks.size(), context.threads, [&](size_t i, int) {
+		if (progress && progress->cancelled) return;
+
+		const auto [stages, frac] = tasks[i];
+
+		thread_local Scratch scratch;
+		stackStages(context, args, stages, frac, scratch);
+
+		const auto& nodes = scratch.nodes;
+		const auto& labels = scratch.labels;
+
+		span<StagePick> picks;
+		{
+			lock_guard guard(foundLock);
+			found[i] = arena.take<Candidate>(labels.size());
+			picks = arena.take<StagePick>(labels.size() * stages);
+		}
+
+		for (size_t l = 0; l < labels.size(); l++) {
+			const span<StagePick> rocket = picks.subspan(l * stages, stages);
+
+			// the leaf is the bottom stage, its parents go back up to the top
+			int node = labels[l];
+			for (int k = stages - 1; k >= 0; k--, node = nodes[node].parent) rocket[k] = nodes[node].stage;
+
+			found[i][l] = { nodes[labels[l]].mass, nodes[labels[l]].engines, rocket };
+			if (progress) context.offer(rocket);
+		}
+
+		if (progress) progress->done++;
+	});
+
+	// room for every candidate of each stage count, more than any front can hold
+	span<size_t> capacities = arena.take<size_t>(max(args.stageCount, 0), 0);
+	for (size_t i = 0; i < tasks.size(); i++) capacities[tasks[i].stages - 1] += found[i].size();
+
+	// merged in task order, so ties always keep the same rocket whatever the thread count
+	ParetoArchive archive(arena, capacities);
+	for (const auto& candidates : found)
+		for (const auto& candidate : candidates) archive.insert(candidate.rocket, candidate.mass, candidate.engines);
+
+	return archive;
+}
+
+vector<vector<Stage>> findParetoMulti(const SolveContext& context, const MultiArgs& args, int iterations) {
+	SolveArena ownArena;
+	const SolveContext withArena{ context.engines, context.threads, context.progress, context.cache, context.tanks, context.arena ? context.arena : &ownArena };
+
+	vector<vector<Stage>> rockets = findParetoPicks(withArena, args, iterations).rockets(withArena);
+	if (context.progress) context.progress->setFront(rockets);
+
+	return rockets;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "solver.hpp"
+
+using namespace std;
+
+namespace KSP {
+	int engineCount(const vector<Stage>& rocket);
+
+	// The rockets nothing else beats on total mass, engine count and stage count all at once.
+	// Stage counts are small, so each gets its own two dimensional front kept sorted by mass
+	// (and so by strictly falling engine count), which turns every dominance check into a
+	// binary search per stage count. Rockets are kept as picks and only turned into Stages on
+	// the way out, and every front's room comes out of an arena, so inserting never allocates.
+	class ParetoArchive {
+	public:
+		ParetoArchive() = default; // with no room for anything
+		// room for capacities[k] rockets of k + 1 stages, taken from `arena`
+		ParetoArchive(SolveArena& arena, span<const size_t> capacities);
+
+		// false if something already in here dominates it; `rocket` is kept by reference, top stage first
+		bool insert(span<const StagePick> rocket, double mass, int engines);
+
+		vector<vector<Stage>> rockets(const SolveContext& context) const; // by stage count, then mass
+		size_t size() const;
+
+	private:
+		struct Entry {
+			double mass;
+			int engines;
+
+			span<const StagePick> rocket;
+		};
+
+		struct Front {
+			span<Entry> entries; // the first `size` of them in use
+			size_t size;
+		};
+
+		span<Front> fronts; // by stage count, from 1
+	};
+};
+
+// Fills a ParetoArchive from `iterations` shared split fractions for every stage count up to
+// args.stageCount, a k stage rocket using the settings of the bottom k stages. Each stage keeps
+// every partial rocket that is lightest for its engine count, not just the lightest overall.
+vector<vector<KSP::Stage>> findParetoMulti(const KSP::SolveContext& context, const KSP::MultiArgs& args, int iterations);
+
+// The same search with the archive itself coming out, its picks in the context's arena (empty
+// without one) and only good until the next solve on it. Never allocates with an arena kept between calls, one thread,
+// and the cache warm or off.
+KSP::ParetoArchive findParetoPicks(const KSP::SolveContext& context, const KSP::MultiArgs& args, int iterations);
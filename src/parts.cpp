@@ -0,0 +1,126 @@
+#include <algorithm>
+
+#include "parts.hpp"
+#include "datfile.hpp"
+
+using namespace std;
+using namespace KSP;
+
+// The part files use the container from datfile.hpp, with these records after the name fields:
+//
+//   tanks.dat       f64 dry mass, f64 wet mass
+//   boosters.dat    f64 dry mass, f64 wet mass, f64 vacIsp, atmIsp, vacThrust, atmThrust
+//   decouplers.dat  f64 mass
+
+namespace {
+	constexpr char tankMagic[8] = { 'R', 'O', 'C', 'K', 'T', 'N', 'K', '\0' };
+	constexpr char boosterMagic[8] = { 'R', 'O', 'C', 'K', 'S', 'R', 'B', '\0' };
+	constexpr char decouplerMagic[8] = { 'R', 'O', 'C', 'K', 'D', 'E', 'C', '\0' };
+	constexpr uint32_t partVersion = 1;
+
+	constexpr size_t tankRecordSize = 24;
+	constexpr size_t boosterRecordSize = 56;
+	constexpr size_t decouplerRecordSize = 16;
+
+	template<class Part, class Fill>
+	bool writeList(const string& path, const char (&magic)[8], size_t recordSize, const vector<Part>& parts, Fill&& fill) {
+		vector<string_view> names;
+		for (const auto& part : parts) names.push_back(part.name);
+
+		vector<char> data;
+		return Dat::build(magic, partVersion, recordSize, names, [&](size_t i, char* record) { fill(parts[i], record); }, data) && Dat::writeFile(path, data);
+	}
+
+	template<class Part, class Read>
+	vector<Part> readList(const string& path, const char (&magic)[8], size_t recordSize, Read&& read) {
+		vector<char> data;
+		Dat::Layout layout;
+		if (!Dat::readFile(path, data) || !Dat::readLayout(data.data(), data.size(), magic, partVersion, recordSize, layout)) return {};
+
+		vector<Part> parts(layout.count);
+		const char* record = layout.records(data.data());
+
+		for (auto& part : parts) {
+			string_view name;
+			if (!Dat::readName(data.data(), layout, record, name)) return {};
+
+			part.name = name;
+			read(part, record);
+			record += layout.recordSize;
+		}
+
+		return parts;
+	}
+}
+
+// PartCatalog
+
+KSP::PartCatalog::PartCatalog(vector<Tank> tanks, vector<Booster> boosters, vector<Decoupler> decouplers) :
+	tanks(move(tanks)), boosters(move(boosters)), decouplers(move(decouplers)) {
+	stable_sort(this->tanks.begin(), this->tanks.end(), [](const Tank& a, const Tank& b) { return a.dryMass < b.dryMass; });
+	stable_sort(this->boosters.begin(), this->boosters.end(), [](const Booster& a, const Booster& b) { return a.dryMass < b.dryMass; });
+	stable_sort(this->decouplers.begin(), this->decouplers.end(), [](const Decoupler& a, const Decoupler& b) { return a.mass < b.mass; });
+
+	// first part wins a name, mod packs sometimes ship the same one twice
+	for (size_t i = 0; i < this->tanks.size(); i++) index.try_emplace(this->tanks[i].name, PartRef{ PartType::Tank, i });
+	for (size_t i = 0; i < this->boosters.size(); i++) index.try_emplace(this->boosters[i].name, PartRef{ PartType::Booster, i });
+	for (size_t i = 0; i < this->decouplers.size(); i++) index.try_emplace(this->decouplers[i].name, PartRef{ PartType::Decoupler, i });
+
+	// tanks that hold nothing don't say anything about what fuel costs
+	double best = __DBL_MAX__;
+	for (const auto& tank : this->tanks)
+		if (tank.fuel() > 0.0 && tank.dryMass >= 0.0) best = min(best, tank.ratio());
+
+	if (best != __DBL_MAX__) bestTankRatio = best;
+}
+
+const KSP::PartRef* KSP::PartCatalog::find(const string& name) const {
+	const auto found = index.find(name);
+	return found == index.end() ? nullptr : &found->second;
+}
+
+// Files
+
+bool KSP::writeParts(const string& directory, const PartCatalog& parts) {
+	const bool tanks = writeList(directory + "/tanks.dat", tankMagic, tankRecordSize, parts.tanks, [](const Tank& tank, char* record) {
+		Dat::put64(record + 8, tank.dryMass);
+		Dat::put64(record + 16, tank.wetMass);
+	});
+
+	const bool boosters = writeList(directory + "/boosters.dat", boosterMagic, boosterRecordSize, parts.boosters, [](const Booster& booster, char* record) {
+		Dat::put64(record + 8, booster.dryMass);
+		Dat::put64(record + 16, booster.wetMass);
+		Dat::put64(record + 24, booster.vacIsp);
+		Dat::put64(record + 32, booster.atmIsp);
+		Dat::put64(record + 40, booster.vacThrust);
+		Dat::put64(record + 48, booster.atmThrust);
+	});
+
+	const bool decouplers = writeList(directory + "/decouplers.dat", decouplerMagic, decouplerRecordSize, parts.decouplers, [](const Decoupler& decoupler, char* record) {
+		Dat::put64(record + 8, decoupler.mass);
+	});
+
+	return tanks && boosters && decouplers;
+}
+
+PartCatalog KSP::loadParts(const string& directory) {
+	auto tanks = readList<Tank>(directory + "/tanks.dat", tankMagic, tankRecordSize, [](Tank& tank, const char* record) {
+		tank.dryMass = Dat::get64(record + 8);
+		tank.wetMass = Dat::get64(record + 16);
+	});
+
+	auto boosters = readList<Booster>(directory + "/boosters.dat", boosterMagic, boosterRecordSize, [](Booster& booster, const char* record) {
+		booster.dryMass = Dat::get64(record + 8);
+		booster.wetMass = Dat::get64(record + 16);
+		booster.vacIsp = Dat::get64(record + 24);
+		booster.atmIsp = Dat::get64(record + 32);
+		booster.vacThrust = Dat::get64(record + 40);
+		booster.atmThrust = Dat::get64(record + 48);
+	});
+
+	auto decouplers = readList<Decoupler>(directory + "/decouplers.dat", decouplerMagic, decouplerRecordSize, [](Decoupler& decoupler, const char* record) {
+		decoupler.mass = Dat::get64(record + 8);
+	});
+
+	return PartCatalog(move(tanks), move(boosters), move(decouplers));
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ksp.hpp"
+#include "catalog.hpp"
+
+using namespace std;
+
+namespace KSP {
+	struct Tank {
+		string name;
+		double dryMass;
+		double wetMass;
+
+		double fuel() const { return wetMass - dryMass; }
+		double ratio() const { return dryMass / fuel(); } // dry mass per tonne of fuel
+	};
+
+	// solid rocket boosters, an engine and its fuel in one part
+	struct Booster {
+		string name;
+		double dryMass;
+		double wetMass;
+
+		double vacIsp;
+		double atmIsp;
+
+		double vacThrust;
+		double atmThrust;
+	};
+
+	struct Decoupler {
+		string name;
+		double mass;
+	};
+
+	enum class PartType { Tank, Booster, Decoupler };
+
+	struct PartRef {
+		PartType type;
+		size_t index; // into the list for `type`
+	};
+
+	// Every non engine part the serializer exported, one list per type plus a name index. Lists
+	// are sorted lightest first (by dry mass), like the engine table.
+	struct PartCatalog {
+		vector<Tank> tanks;
+		vector<Booster> boosters;
+		vector<Decoupler> decouplers;
+
+		PartCatalog() = default;
+		PartCatalog(vector<Tank> tanks, vector<Booster> boosters, vector<Decoupler> decouplers);
+
+		const PartRef* find(const string& name) const; // nullptr for unknown names
+
+		// lightest tank dry mass per tonne of fuel, what the stage search budgets for LFO engines
+		double tankRatio() const { return bestTankRatio; }
+
+	private:
+		unordered_map<string, PartRef> index;
+		double bestTankRatio = fuelRatio; // the stock 1:8 when there are no tanks to go by
+	};
+
+	// partdata/tanks.dat, boosters.dat and decouplers.dat, see parts.cpp for the records
+	bool writeParts(const string& directory, const PartCatalog& parts);
+	PartCatalog loadParts(const string& directory); // types whose file is missing or invalid come back empty
+};
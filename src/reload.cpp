@@ -0,0 +1,191 @@
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "reload.hpp"
+#include "datfile.hpp"
+#include "catalog.generated.hpp"
+
+using namespace std;
+using namespace KSP;
+
+namespace {
+	uint64_t hashCatalog(const EngineTable& engines, const vector<Tank>& tanks) {
+		uint64_t hash = Dat::hash("", 0);
+		auto numbers = [&](span<const double> column) {
+			for (double value : column) {
+				char bytes[8];
+				Dat::put64(bytes, value);
+				hash = Dat::hash(bytes, 8, hash);
+			}
+		};
+		// the length first, so neighbouring names can't run into each other
+		auto text = [&](string_view name) {
+			char bytes[4];
+			Dat::put32(bytes, name.size());
+			hash = Dat::hash(name.data(), name.size(), Dat::hash(bytes, 4, hash));
+		};
+
+		for (string_view name : engines.names) text(name);
+		for (auto column : { engines.mass, engines.vacIsp, engines.atmIsp, engines.vacThrust, engines.atmThrust, engines.tankRatio })
+			numbers(column);
+
+		for (const Tank& tank : tanks) {
+			text(tank.name);
+			numbers(array{ tank.dryMass, tank.wetMass });
+		}
+
+		return hash;
+	}
+};
+
+EngineTable KSP::builtInTable(double tankRatio) {
+	if (tankRatio == stockTankRatio) return EngineTable(stockTable); // nothing to copy
+
+	vector<Engine> engines;
+	for (const StaticEngine& engine : stockEngines)
+		engines.push_back(Engine{ string(engine.name), engine.mass, engine.vacIsp, engine.atmIsp, engine.vacThrust, engine.atmThrust });
+
+	return EngineTable(engines, tankRatio);
+}
+
+KSP::Catalog::Catalog(PartCatalog parts, EngineTable engines) :
+	parts(move(parts)), engines(move(engines)), tanks(this->parts.tanks), hash(hashCatalog(this->engines, this->parts.tanks)) {
+	for (const Body& body : bodies) altitudes.emplace_back(body, this->engines);
+}
+
+bool KSP::sameParts(const Catalog& before, const Catalog& after, span<const vector<Stage>> rockets) {
+	auto row = [](const EngineTable& engines, const string& name) {
+		for (size_t i = 0; i < engines.size(); i++)
+			if (engines.names[i] == name) return i;
+		return engines.size();
+	};
+
+	for (const auto& rocket : rockets) {
+		for (const Stage& stage : rocket) {
+			if (!stage.feasible()) continue;
+
+			const size_t was = row(before.engines, stage.engine.name), is = row(after.engines, stage.engine.name);
+			if (was == before.engines.size() || is == after.engines.size()) return false;
+
+			for (auto column : { &EngineTable::mass, &EngineTable::vacIsp, &EngineTable::atmIsp, &EngineTable::vacThrust, &EngineTable::atmThrust, &EngineTable::tankRatio })
+				if ((before.engines.*column)[was] != (after.engines.*column)[is]) return false;
+
+			for (const auto& [tank, count] : stage.tanks) {
+				if ((size_t)tank >= after.parts.tanks.size()) return false;
+
+				const Tank& a = before.parts.tanks[tank];
+				const Tank& b = after.parts.tanks[tank];
+				if (a.name != b.name || a.dryMass != b.dryMass || a.wetMass != b.wetMass) return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+shared_ptr<const Catalog> KSP::loadCatalog(const string& enginePath, const string& partDirectory) {
+	// the built in table budgets for the tanks it was generated with, loaded tanks take over from those
+	PartCatalog parts = loadParts(partDirectory);
+	auto file = make_shared<const EngineFile>(enginePath);
+	EngineTable engines = file->size() ? EngineTable(file, parts.tankRatio()) : builtInTable(parts.tankRatio());
+
+	return make_shared<const Catalog>(move(parts), move(engines));
+}
+
+// CatalogWatcher
+
+KSP::CatalogWatcher::CatalogWatcher(string enginePath, string partDirectory) :
+	enginePath(move(enginePath)), partDirectory(move(partDirectory)) {
+	catalog = loadCatalog(this->enginePath, this->partDirectory);
+
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (fd < 0 || stopFd < 0) return;
+
+	// directories rather than the files, a file renamed over is a new file the old watch never sees
+	const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO;
+	filesystem::path engineDirectory = filesystem::path(this->enginePath).parent_path();
+	if (engineDirectory.empty()) engineDirectory = ".";
+
+	bool any = inotify_add_watch(fd, engineDirectory.c_str(), mask) >= 0;
+	if (engineDirectory != filesystem::path(this->partDirectory))
+		any |= inotify_add_watch(fd, this->partDirectory.c_str(), mask) >= 0;
+
+	if (!any) {
+		close(fd);
+		fd = -1;
+		return;
+	}
+
+	worker = thread([this] { watch(); });
+}
+
+KSP::CatalogWatcher::~CatalogWatcher() {
+	if (worker.joinable()) {
+		const uint64_t one = 1;
+		(void)!write(stopFd, &one, sizeof(one));
+		worker.join();
+	}
+
+	if (fd >= 0) close(fd);
+	if (stopFd >= 0) close(stopFd);
+}
+
+void KSP::CatalogWatcher::watch() {
+	const string engineName = filesystem::path(enginePath).filename().string();
+	auto relevant = [&](const char* name) {
+		return name == engineName || !strcmp(name, "tanks.dat") || !strcmp(name, "boosters.dat") || !strcmp(name, "decouplers.dat");
+	};
+
+	// true when something we load from changed, false once there's nothing left to read
+	auto drain = [&] {
+		alignas(inotify_event) char buffer[4096];
+		bool changed = false;
+
+		ssize_t got;
+		while ((got = read(fd, buffer, sizeof(buffer))) > 0) {
+			for (char* p = buffer; p < buffer + got;) {
+				const auto* event = (const inotify_event*)p;
+				if (event->len && relevant(event->name)) changed = true;
+				p += sizeof(inotify_event) + event->len;
+			}
+		}
+
+		return changed;
+	};
+
+	pollfd fds[2] = { { fd, POLLIN, 0 }, { stopFd, POLLIN, 0 } };
+	bool pending = false;
+
+	while (true) {
+		// once something changed, wait for things to go quiet first: the serializer writes
+		// several files in a row and they should all land in one reload
+		const int ready = poll(fds, 2, pending ? 200 : -1);
+		if (ready < 0 && errno != EINTR) return;
+		if (fds[1].revents) return;
+
+		if (ready > 0 && fds[0].revents) pending |= drain();
+		else if (pending) {
+			pending = false;
+			reload();
+		}
+	}
+}
+
+void KSP::CatalogWatcher::reload() {
+	// a half written or broken file isn't a reason to lose the engines we have
+	auto file = make_shared<const EngineFile>(enginePath);
+	if (!file->size()) return;
+
+	PartCatalog parts = loadParts(partDirectory);
+	EngineTable engines(file, parts.tankRatio());
+
+	catalog = make_shared<const Catalog>(move(parts), move(engines));
+	published++;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "bodies.hpp"
+#include "parts.hpp"
+#include "solver.hpp"
+#include "tanks.hpp"
+
+using namespace std;
+
+namespace KSP {
+	// Everything a solve needs out of partdata, loaded as one piece so a reload swaps all of it
+	// together. Never changed once built: a new catalog is a new Catalog.
+	struct Catalog {
+		PartCatalog parts;
+		EngineTable engines;
+		TankSolver tanks;
+
+		uint64_t hash; // of every engine column and tank, the same for the same catalog in any process
+
+		vector<AltitudeTable> altitudes; // the engines over every one of `bodies`, in its order
+
+		Catalog(PartCatalog parts, EngineTable engines);
+	};
+
+	// The built in engines budgeting `tankRatio` for tanks, pointing straight at the generated
+	// table when that's the ratio it was generated with.
+	EngineTable builtInTable(double tankRatio);
+
+	// Whether every engine and tank `rockets` (solved on `before`) are built from is in `after`
+	// unchanged, tanks at the same index too, so they still fly as solved.
+	bool sameParts(const Catalog& before, const Catalog& after, span<const vector<Stage>> rockets);
+
+	// The engines at `enginePath` (the built in table when there's no valid file there) and the
+	// other parts in `partDirectory`.
+	shared_ptr<const Catalog> loadCatalog(const string& enginePath, const string& partDirectory);
+
+	// Watches the catalog files with inotify and rebuilds the catalog on its own thread whenever
+	// one of them is written or renamed into place. The new catalog is published by swapping a
+	// single pointer, so whoever took the old one (a solve halfway through, say) keeps using it
+	// untouched and it goes away with its last user. A rebuild that finds no valid engine file
+	// keeps the catalog it had rather than dropping back to the built in one.
+	class CatalogWatcher {
+	public:
+		CatalogWatcher(string enginePath, string partDirectory);
+		~CatalogWatcher();
+
+		CatalogWatcher(const CatalogWatcher&) = delete;
+		CatalogWatcher& operator=(const CatalogWatcher&) = delete;
+
+		shared_ptr<const Catalog> current() const { return catalog.load(); }
+		size_t generation() const { return published; } // bumped after every swap
+
+		bool watching() const { return fd >= 0; } // false when inotify isn't available, the catalog just never changes
+
+	private:
+		void watch();
+		void reload();
+
+		const string enginePath;
+		const string partDirectory;
+
+		atomic<shared_ptr<const Catalog>> catalog;
+		atomic<size_t> published = 0;
+
+		int fd = -1;
+		int stopFd = -1;
+		thread worker;
+	};
+};
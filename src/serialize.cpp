@@ -2,9 +2,21 @@
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <thread>
+#include <sstream>
+#include <filesystem>
+#include <cstring>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <nlohmann/json.hpp>
 
 #include "ksp.hpp"
+#include "enginefile.hpp"
+#include "parts.hpp"
+#include "parallel.hpp"
 
 
 using json = nlohmann::json;
@@ -20,50 +32,471 @@ enum PartTypes {
 	DECOUPLER,
 };
 
-KSP::Engine convertEngine(json part) {
+KSP::Engine convertEngine(const json& part) {
 	KSP::Engine engine;
 
-	engine.name = part["name"];
-	engine.mass = part["mass"];
+	engine.name = part.at("name");
+	engine.mass = part.at("mass");
 
-	engine.vacIsp = part["vacIsp"];
-	engine.atmIsp = part["atmIsp"];
+	engine.vacIsp = part.at("vacIsp");
+	engine.atmIsp = part.at("atmIsp");
 
-	engine.vacThrust = part["vacThrust"];
-	engine.atmThrust = part["atmThrust"];
+	engine.vacThrust = part.at("vacThrust");
+	engine.atmThrust = part.at("atmThrust");
 
 	return engine;
 }
 
-int main() {
-	ifstream partsFile("parts.json");
-	json partsJson;
-	partsFile >> partsJson;
+// tanks and boosters list their full mass and how much of it is left once the fuel is gone
 
+KSP::Tank convertTank(const json& part) {
+	return KSP::Tank{ part.at("name"), part.at("dryMass"), part.at("mass") };
+}
+
+KSP::Booster convertBooster(const json& part) {
+	return KSP::Booster{ part.at("name"), part.at("dryMass"), part.at("mass"), part.at("vacIsp"), part.at("atmIsp"), part.at("vacThrust"), part.at("atmThrust") };
+}
+
+KSP::Decoupler convertDecoupler(const json& part) {
+	return KSP::Decoupler{ part.at("name"), part.at("mass") };
+}
+
+PartTypes partType(const string& type) {
+	if (type == "TYPES.LFO_ENGINE") return LFO_ENGINE;
+	if (type == "TYPES.LFO_TANK") return LFO_TANK;
+	if (type == "TYPES.BOOSTER") return BOOSTER;
+	if (type == "TYPES.DECOUPLER") return DECOUPLER;
+
+	return UNKNOWN;
+}
+
+struct Parts {
 	vector<KSP::Engine> engines;
+	vector<KSP::Tank> tanks;
+	vector<KSP::Booster> boosters;
+	vector<KSP::Decoupler> decouplers;
+
+	void add(const json& part) {
+		switch (partType(part.value("type", ""))) {
+			case LFO_ENGINE: engines.push_back(convertEngine(part)); break;
+			case LFO_TANK: tanks.push_back(convertTank(part)); break;
+			case BOOSTER: boosters.push_back(convertBooster(part)); break;
+			case DECOUPLER: decouplers.push_back(convertDecoupler(part)); break;
+			case UNKNOWN: break;
+		}
+	}
+
+	void append(Parts&& other) {
+		for (auto& engine : other.engines) engines.push_back(move(engine));
+		for (auto& tank : other.tanks) tanks.push_back(move(tank));
+		for (auto& booster : other.boosters) boosters.push_back(move(booster));
+		for (auto& decoupler : other.decouplers) decouplers.push_back(move(decoupler));
+	}
+};
+
+// Streams a parts.json through the SAX interface and only ever builds the part it is in the
+// middle of, packs[].parts[] one at a time. Once a part's "type" says it isn't one we keep,
+// the rest of it is skipped without being stored at all. With `lonePack` the document is one
+// entry of "packs" on its own, and its parts[] are read the same way.
+class PartReader : public nlohmann::json_sax<json> {
+public:
+	PartReader(Parts& parts, bool lonePack) : parts(parts), packDepth(lonePack ? 0 : 2) {}
+
+	std::string error;
+
+	bool null() override { return value(nullptr); }
+	bool boolean(bool v) override { return value(v); }
+	bool number_integer(number_integer_t v) override { return value(v); }
+	bool number_unsigned(number_unsigned_t v) override { return value(v); }
+	bool number_float(number_float_t v, const string_t&) override { return value(v); }
+	bool string(string_t& v) override { return value(move(v)); }
+	bool binary(binary_t& v) override { return value(json::binary(move(v))); }
+
+	bool start_object(size_t) override { return open(json::object()); }
+	bool start_array(size_t) override { return open(json::array()); }
+	bool end_object() override { return close(); }
+	bool end_array() override { return close(); }
+
+	bool key(string_t& name) override {
+		pendingKey = move(name);
+		return true;
+	}
+
+	bool parse_error(size_t, const std::string&, const nlohmann::detail::exception& e) override {
+		error = e.what();
+		return false;
+	}
+
+private:
+	struct Frame {
+		bool array;
+		std::string key; // what the container was under in its parent, empty in arrays
+	};
+
+	Parts& parts;
+	const size_t packDepth; // frames open around a pack: none for a lone one, the root and "packs" otherwise
+
+	vector<Frame> frames; // every open container, from the document root down
+	std::string pendingKey;
+
+	json part;
+	vector<json*> building; // open containers inside `part`, empty while outside one or skipping it
+	size_t partDepth = 0; // frames.size() with the part open, 0 outside one
+	bool skipping = false;
+
+	// the next container opened is a part when we are right inside { "packs": [ { "parts": [,
+	// or just { "parts": [ for a lone pack
+	bool atPart() const {
+		if (partDepth != 0 || frames.size() != packDepth + 2) return false;
+
+		const Frame& list = frames.back();
+		return list.key == "parts" && list.array && (packDepth == 0 || frames[1].key == "packs");
+	}
+
+	json* insert(json&& v) {
+		json& parent = *building.back();
+		if (parent.is_array()) {
+			parent.push_back(move(v));
+			return &parent.back();
+		}
+
+		json& slot = parent[pendingKey];
+		slot = move(v);
+		return &slot;
+	}
+
+	bool value(json&& v) {
+		if (building.empty()) return true;
+
+		// a part's own type, which is all it takes to know whether to keep it
+		if (building.size() == 1 && pendingKey == "type" && v.is_string() && partType(v.get<std::string>()) == UNKNOWN) {
+			skipping = true;
+			building.clear();
+			part = json();
+			return true;
+		}
+
+		insert(move(v));
+		return true;
+	}
+
+	bool open(json&& container) {
+		const bool array = container.is_array();
+
+		if (atPart()) {
+			part = move(container);
+			building = { &part };
+			skipping = false;
+			partDepth = frames.size() + 1;
+		}
+		else if (!building.empty()) {
+			building.push_back(insert(move(container)));
+		}
+
+		const bool inObject = !frames.empty() && !frames.back().array;
+		frames.push_back(Frame{ array, inObject ? pendingKey : std::string() });
+		return true;
+	}
+
+	bool close() {
+		if (partDepth && frames.size() == partDepth) {
+			if (!skipping) {
+				try {
+					parts.add(part);
+				}
+				catch (const json::exception& e) {
+					error = "bad part " + part.value("name", std::string("(unnamed)")) + ": " + e.what();
+					return false;
+				}
+			}
+
+			part = json();
+			building.clear();
+			partDepth = 0;
+		}
+		else if (!building.empty()) {
+			building.pop_back();
+		}
+
+		frames.pop_back();
+		return true;
+	}
+};
+
+// Pack cache
+//
+// Converted parts are kept per pack under partdata/cache/<hash of its text>/, as the same .dat
+// files the catalog itself is made of. Files are mapped rather than read and split into their
+// "packs" entries by a scan that only tracks strings and brackets, so a pack that hasn't changed
+// since some earlier run (in any file, next to any other packs) is read back from there and only
+// the edited ones get parsed, straight out of the mapping.
+
+constexpr uint64_t cacheVersion = 2; // bump whenever conversion changes, so old entries stop matching
+
+uint64_t hashText(string_view text) {
+	uint64_t hash = 0xcbf29ce484222325 ^ cacheVersion;
+
+	for (size_t i = 0; i < text.size(); i += 8) {
+		uint64_t word = 0;
+		memcpy(&word, &text[i], min<size_t>(8, text.size() - i));
+		hash = (hash ^ word) * 0x100000001b3;
+		hash ^= hash >> 29;
+	}
+
+	return (hash ^ text.size()) * 0x100000001b3; // so trailing zero bytes still count
+}
+
+// The text of every entry in the root object's "packs" array, without parsing any of them. False
+// when the file isn't shaped like that, and then the full parse gets to say what's wrong with it.
+bool splitPacks(string_view text, vector<string_view>& packs) {
+	int depth = 0;
+	bool inPacks = false;
+	bool sawPacks = false;
+	string_view lastKey; // the last string straight inside the root object
+	size_t start = 0; // of the pack being scanned
+
+	for (size_t i = 0; i < text.size(); i++) {
+		const char c = text[i];
+
+		if (c == '"') {
+			const size_t begin = ++i;
+			while (i < text.size() && text[i] != '"') i += text[i] == '\\' ? 2 : 1;
+			if (i >= text.size()) return false;
+
+			if (depth == 1) lastKey = text.substr(begin, i - begin);
+		}
+		else if (c == '{' || c == '[') {
+			depth++;
+			if (depth == 2 && c == '[' && lastKey == "packs") inPacks = sawPacks = true;
+			else if (inPacks && depth == 3) start = i;
+		}
+		else if (c == '}' || c == ']') {
+			if (inPacks && depth == 3) packs.push_back(text.substr(start, i + 1 - start));
+			if (depth == 2) inPacks = false;
+			if (--depth < 0) return false;
+		}
+	}
+
+	return depth == 0 && sawPacks;
+}
+
+string cacheDirectory(uint64_t hash) {
+	char name[17];
+	snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+
+	return "partdata/cache/" + string(name);
+}
+
+// an entry only counts once its marker is there, which gets written last
+bool loadCached(const string& directory, Parts& parts) {
+	if (!filesystem::exists(directory + "/complete")) return false;
+
+	KSP::PartCatalog catalog = KSP::loadParts(directory);
+	parts.engines = KSP::loadEngines(directory + "/engines.dat");
+	parts.tanks = move(catalog.tanks);
+	parts.boosters = move(catalog.boosters);
+	parts.decouplers = move(catalog.decouplers);
+
+	return true;
+}
+
+void storeCached(const string& directory, const Parts& parts) {
+	error_code error;
+	filesystem::create_directories(directory, error);
+	if (error) return; // no cache this time, the catalog still gets written
+
+	const bool stored = KSP::writeEngines(directory + "/engines.dat", parts.engines) &&
+		KSP::writeParts(directory, KSP::PartCatalog(parts.tanks, parts.boosters, parts.decouplers));
+
+	if (stored) ofstream(directory + "/complete");
+}
+
+bool parseParts(string_view text, bool lonePack, Parts& parts, string& error) {
+	PartReader reader(parts, lonePack);
+	if (json::sax_parse(text.begin(), text.end(), &reader)) return true;
+
+	error = reader.error.empty() ? "parse failed" : reader.error;
+	return false;
+}
+
+// one entry of a file's "packs" array, or the whole file when it couldn't be split
+struct Pack {
+	string_view text;
+	bool whole = false;
+
+	Parts parts;
+	string error;
+	bool cached = false;
+};
+
+// a parts file mapped read only, its packs pointing into the mapping
+struct PackFile {
+	const char* mapping = nullptr;
+	size_t size = 0;
+
+	vector<Pack> packs;
+	string error;
+
+	PackFile() = default;
+	PackFile(const PackFile&) = delete;
+	PackFile& operator=(const PackFile&) = delete;
+	~PackFile() {
+		if (mapping) munmap((void*)mapping, size);
+	}
+};
+
+void readFile(const string& path, PackFile& file) {
+	const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	struct stat info;
+	if (fd < 0 || fstat(fd, &info) != 0) {
+		if (fd >= 0) close(fd);
+		file.error = "couldn't open it";
+		return;
+	}
+
+	// an empty file has nothing to map, the parse gets to say what's wrong with it
+	if (info.st_size > 0) {
+		void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapping == MAP_FAILED) {
+			close(fd);
+			file.error = "couldn't map it";
+			return;
+		}
+
+		madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+		file.mapping = (const char*)mapping;
+		file.size = info.st_size;
+	}
+	close(fd); // the mapping keeps the file alive
 
-	for (auto& pack : partsJson["packs"]) {
-		for (auto& part : pack["parts"]) {
-			if (part["type"] == "TYPES.LFO_ENGINE") {
-				engines.push_back(convertEngine(part));
+	const string_view text(file.mapping, file.size);
+
+	vector<string_view> texts;
+	if (!splitPacks(text, texts)) {
+		file.packs.push_back(Pack{ text, true });
+		return;
+	}
+
+	for (string_view text : texts) file.packs.push_back(Pack{ text });
+}
+
+void readPack(bool useCache, Pack& pack) {
+	if (pack.whole) {
+		parseParts(pack.text, false, pack.parts, pack.error);
+		return;
+	}
+
+	const string directory = cacheDirectory(hashText(pack.text));
+	if (useCache && loadCached(directory, pack.parts)) {
+		pack.cached = true;
+		return;
+	}
+
+	if (!parseParts(pack.text, true, pack.parts, pack.error)) return;
+
+	if (useCache) storeCached(directory, pack.parts);
+}
+
+// serialize [--header path] [--report] [--no-cache] [pack.json...]
+//
+// Reads every pack file given (parts.json when there are none), converting the packs in them
+// several at once, and writes partdata/engines.dat and the other part files next to it. Files
+// come out through an atomic rename and only when their contents changed. With --header it also
+// writes a C++ header that builds the same engines into rock at compile time
+// (src/catalog.generated.hpp is the one rock uses), and --report lists every file and engine.
+// Parts come out in the order the files, and the packs in them, were given.
+int main(int argc, char** argv) {
+	string headerPath;
+	bool report = false;
+	bool useCache = true;
+	vector<string> packPaths;
+	for (int i = 1; i < argc; i++) {
+		const string arg = argv[i];
+
+		if (arg == "--header" && i + 1 < argc) headerPath = argv[++i];
+		else if (arg == "--report") report = true;
+		else if (arg == "--no-cache") useCache = false;
+		else packPaths.push_back(arg);
+	}
+	if (packPaths.empty()) packPaths.push_back("parts.json");
+
+	vector<PackFile> files(packPaths.size());
+	parallelFor(packPaths.size(), max(thread::hardware_concurrency(), 1u), [&](size_t i, int) {
+		readFile(packPaths[i], files[i]);
+	}, 1);
+
+	// every pack of every file at once, then merged back in file and pack order
+	vector<Pack*> packs;
+	for (auto& file : files)
+		for (auto& pack : file.packs) packs.push_back(&pack);
+
+	parallelFor(packs.size(), max(thread::hardware_concurrency(), 1u), [&](size_t i, int) {
+		readPack(useCache, *packs[i]);
+	}, 1);
+
+	Parts all;
+	size_t cached = 0;
+	vector<size_t> fileEngines; // for the report, the packs themselves get merged away
+	for (size_t i = 0; i < files.size(); i++) {
+		if (!files[i].error.empty()) {
+			cerr << packPaths[i] << ": " << files[i].error << endl;
+			return 1;
+		}
+
+		fileEngines.push_back(0);
+		for (size_t j = 0; j < files[i].packs.size(); j++) {
+			Pack& pack = files[i].packs[j];
+			if (!pack.error.empty()) {
+				cerr << packPaths[i] << (pack.whole ? "" : ", pack " + to_string(j + 1)) << ": " << pack.error << endl;
+				return 1;
 			}
+
+			cached += pack.cached;
+			fileEngines.back() += pack.parts.engines.size();
+			all.append(move(pack.parts));
 		}
 	}
 
+	const vector<KSP::Engine>& engines = all.engines;
+	const size_t tankCount = all.tanks.size(), boosterCount = all.boosters.size(), decouplerCount = all.decouplers.size();
+
+
+	if (!KSP::writeEngines("partdata/engines.dat", engines)) {
+		cerr << "couldn't write partdata/engines.dat" << endl;
+		return 1;
+	}
+
+	const KSP::PartCatalog parts(move(all.tanks), move(all.boosters), move(all.decouplers));
+	if (!KSP::writeParts("partdata", parts)) {
+		cerr << "couldn't write the part files in partdata" << endl;
+		return 1;
+	}
+
+	// the same tank ratio loadCatalog budgets for with these parts on disk
+	if (!headerPath.empty() && !KSP::writeEngineHeader(headerPath, engines, parts.tankRatio())) {
+		cerr << "couldn't write " << headerPath << endl;
+		return 1;
+	}
+
+	// built up and written in one go rather than flushed line by line
+	ostringstream out;
+	out << files.size() << " files, " << packs.size() << " packs (" << cached << " cached): " << engines.size() << " engines, " << tankCount << " tanks, "
+		<< boosterCount << " boosters, " << decouplerCount << " decouplers\n";
 
-	ofstream file;
+	if (report) {
+		out << '\n';
+		for (size_t i = 0; i < files.size(); i++) {
+			size_t fileCached = 0;
+			for (const auto& pack : files[i].packs) fileCached += pack.cached;
+			out << packPaths[i] << " (" << fileCached << " of " << files[i].packs.size() << " packs cached): " << fileEngines[i] << " engines\n";
+		}
 
-	file.open("partdata/engines.dat", ios::trunc);
-	for (const auto& part : engines) { 
-		file << part;
-		cout << part.name << endl;
-		cout << part.mass << endl;
-		cout << part.vacIsp << endl;
-		cout << part.atmIsp << endl;
-		cout << part.vacThrust << endl;
-		cout << part.atmThrust << endl;
+		out << "\nname\tmass\tvacIsp\tatmIsp\tvacThrust\tatmThrust\n";
+		for (const auto& part : engines)
+			out << part.name << '\t' << part.mass << '\t' << part.vacIsp << '\t' << part.atmIsp << '\t' << part.vacThrust << '\t' << part.atmThrust << '\n';
 	}
-	file.close();
+
+	cout << out.str() << flush;
 
 	return 0;
-}
\ No newline at end of file
+}
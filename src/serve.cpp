@@ -0,0 +1,334 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <nlohmann/json.hpp>
+
+#include "serve.hpp"
+#include "datfile.hpp"
+#include "parallel.hpp"
+
+using json = nlohmann::json;
+
+using namespace std;
+using namespace KSP;
+
+namespace {
+	constexpr size_t maxMessage = 1 << 20; // anything longer is a confused client, not a mission
+	constexpr size_t maxOutbox = 64 << 20; // answers a client has left unread before it gets dropped
+
+	struct Client {
+		int fd;
+		string inbox; // bytes read that don't make a whole message yet
+
+		// answers queued for it and not sent yet, each one's end in `outbox` with when its request came in
+		string outbox;
+		vector<pair<size_t, chrono::steady_clock::time_point>> unsent;
+
+		bool closed = false; // nothing more goes either way
+		bool finished = false; // hung up its end, still gets answers to what it sent before closing
+	};
+
+	struct Request {
+		size_t client; // index into the clients of the round
+		string body;
+		chrono::steady_clock::time_point received;
+
+		string answer;
+		bool stats = false; // answered after the round, once every other answer is in
+	};
+
+	// the last few thousand request latencies in microseconds, received to answered
+	struct Latencies {
+		vector<double> recent = vector<double>(4096);
+		size_t count = 0;
+
+		void add(double us) { recent[count++ % recent.size()] = us; }
+
+		double percentile(double p) const {
+			vector<double> sorted(recent.begin(), recent.begin() + min(count, recent.size()));
+			if (sorted.empty()) return 0.0;
+
+			const size_t i = min((size_t)(p * sorted.size()), sorted.size() - 1);
+			nth_element(sorted.begin(), sorted.begin() + i, sorted.end());
+			return sorted[i];
+		}
+	};
+
+	MultiArgs binaryArgs(const string& body, BatchSolver& solver) {
+		constexpr size_t fixed = 48;
+		if (body.size() < fixed || body.compare(0, 4, "RKQ1") != 0) throw runtime_error("not a request");
+
+		const char* in = body.data();
+		const uint32_t stages = Dat::get32(in + 8);
+		if (stages == 0 || body.size() != fixed + 16 * (size_t)stages) throw runtime_error("request size doesn't match its stage count");
+
+		const uint32_t code = Dat::get32(in + 4);
+		solver = code == 1 ? BatchSolver::Sweep : code == 2 ? BatchSolver::Split : BatchSolver::Exact;
+
+		MultiArgs args{ Dat::get64(in + 16), Dat::get64(in + 24), Dat::get64(in + 32), (int)stages, vector<double>(stages), vector<double>(stages) };
+		args.maxEngines = (int)Dat::get32(in + 12);
+		args.decouplerMass = Dat::get64(in + 40);
+		for (size_t i = 0; i < stages; i++) {
+			args.atm[i] = Dat::get64(in + fixed + 8 * i);
+			args.twr[i] = Dat::get64(in + fixed + 8 * (stages + i));
+		}
+
+		if (args.maxEngines < 1) throw runtime_error("max engines has to be at least 1");
+		return args;
+	}
+
+	string binaryAnswer(const vector<Stage>& rocket) {
+		string out = "RKA1";
+		if (rocket.empty() || !rocket.back().feasible()) throw runtime_error("no rocket can fly this mission");
+
+		Dat::append32(out, 0);
+		Dat::append64(out, rocket.back().mass);
+		Dat::append32(out, rocket.size());
+		for (const auto& stage : rocket) {
+			Dat::append32(out, stage.count);
+			Dat::append64(out, stage.mass);
+			Dat::append32(out, stage.engine.name.size());
+			out += stage.engine.name;
+		}
+
+		return out;
+	}
+
+	void answer(Request& request, const SolveContext& context, BatchSolver fallback, SolutionCache* solutions) {
+		const bool binary = request.body.empty() || request.body[0] != '{';
+
+		if (binary) {
+			try {
+				BatchSolver solver = fallback;
+				const MultiArgs args = binaryArgs(request.body, solver);
+				request.answer = binaryAnswer(solveMission(context, args, solver, solutions));
+			}
+			catch (const exception& e) {
+				const string message = e.what();
+				request.answer = "RKA1";
+				Dat::append32(request.answer, 1);
+				Dat::append32(request.answer, message.size());
+				request.answer += message;
+			}
+			return;
+		}
+
+		json result = json::object();
+		try {
+			const json record = json::parse(request.body);
+			if (record.contains("id")) result["id"] = record["id"];
+
+			if (record.value("stats", false)) {
+				request.stats = true;
+				return;
+			}
+
+			const string solver = record.value("solver", "");
+			result.update(rocketJson(solveMission(context, missionArgs(record), solver.empty() ? fallback : batchSolver(solver), solutions)));
+		}
+		catch (const exception& e) {
+			result["error"] = e.what();
+		}
+
+		request.answer = result.dump();
+	}
+
+	// as much of the client's outbox as its socket takes without waiting, the rest goes once poll
+	// says there's room; every answer that got out whole counts as served
+	void flush(Client& client, Latencies& latencies, size_t& served) {
+		size_t sent = 0;
+		while (sent < client.outbox.size()) {
+			const ssize_t n = send(client.fd, client.outbox.data() + sent, client.outbox.size() - sent, MSG_NOSIGNAL);
+			if (n > 0) sent += n;
+			else if (n < 0 && errno == EINTR) continue;
+			else {
+				if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) client.closed = true;
+				break;
+			}
+		}
+
+		const auto now = chrono::steady_clock::now();
+		size_t answered = 0;
+		for (; answered < client.unsent.size() && client.unsent[answered].first <= sent; answered++) {
+			served++;
+			latencies.add(chrono::duration<double, micro>(now - client.unsent[answered].second).count());
+		}
+
+		client.unsent.erase(client.unsent.begin(), client.unsent.begin() + answered);
+		for (auto& [end, received] : client.unsent) end -= sent;
+		client.outbox.erase(0, sent);
+	}
+};
+
+int KSP::runServer(const string& path, const ServeOptions& options) {
+	// taken as something to poll for instead, so the loop gets to clean up on the way out; blocked
+	// before any thread starts so none of them gets handed the signal either
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+	const int signalFd = signalfd(-1, &signals, SFD_CLOEXEC);
+
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path)) {
+		cerr << "socket path too long: " << path << endl;
+		return 1;
+	}
+	memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+	// a socket some earlier server left behind is fair game, any other file isn't
+	struct stat existing;
+	if (lstat(path.c_str(), &existing) == 0) {
+		if (!S_ISSOCK(existing.st_mode)) {
+			cerr << path << " exists and isn't a socket" << endl;
+			return 1;
+		}
+		unlink(path.c_str());
+	}
+
+	const int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (signalFd < 0 || listener < 0 || bind(listener, (const sockaddr*)&address, sizeof(address)) < 0 || listen(listener, 64) < 0) {
+		cerr << "couldn't listen on " << path << ": " << strerror(errno) << endl;
+		return 1;
+	}
+
+	CatalogWatcher watcher(options.enginePath, "partdata");
+	shared_ptr<const Catalog> catalog = watcher.current();
+	size_t generation = watcher.generation();
+
+	const int threads = max(options.threads, 1);
+	auto cache = make_unique<StageCache>(1 << 18);
+	// finished rockets belong to the catalog they were solved on, a reload opens the file again for the new one
+	auto openSolutions = [&] { return options.solutions.empty() ? nullptr : make_unique<SolutionCache>(options.solutions, catalog->hash); };
+	unique_ptr<SolutionCache> solutions = openSolutions();
+	vector<SolveArena> arenas(threads);
+	WorkerPool workers(threads); // kept up between rounds, a round is often only a few requests
+
+	vector<Client> clients;
+	vector<Request> round;
+	vector<pollfd> fds;
+
+	Latencies latencies;
+	size_t served = 0, rounds = 0, largestRound = 0;
+
+	cerr << "serving " << catalog->engines.size() << " engines on " << path << endl;
+
+	while (true) {
+		// a client that hung up only gets waited on to take its answers
+		fds.assign({ { signalFd, POLLIN, 0 }, { listener, POLLIN, 0 } });
+		for (const auto& client : clients)
+			fds.push_back({ client.fd, (short)((client.finished ? 0 : POLLIN) | (client.outbox.empty() ? 0 : POLLOUT)), 0 });
+
+		if (poll(fds.data(), fds.size(), -1) < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+		if (fds[0].revents) break;
+
+		for (size_t c = 0; c < clients.size(); c++) {
+			if (!fds[c + 2].revents) continue;
+			Client& client = clients[c];
+
+			// a hung up or broken socket gets flushed too, which is what finds out it's gone
+			if (!client.outbox.empty()) flush(client, latencies, served);
+			if (client.finished || client.closed || !(fds[c + 2].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+			char buffer[1 << 16];
+			ssize_t got;
+			while ((got = read(client.fd, buffer, sizeof(buffer))) > 0) client.inbox.append(buffer, got);
+			if (got == 0) client.finished = true;
+			else if (got < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) client.closed = true;
+
+			// every whole message is a request for this round
+			const auto now = chrono::steady_clock::now();
+			size_t used = 0;
+			while (client.inbox.size() - used >= 4) {
+				const size_t length = Dat::get32(client.inbox.data() + used);
+				if (length > maxMessage) {
+					client.closed = true;
+					break;
+				}
+				if (client.inbox.size() - used - 4 < length) break;
+
+				round.push_back(Request{ c, client.inbox.substr(used + 4, length), now });
+				used += 4 + length;
+			}
+			client.inbox.erase(0, used);
+		}
+
+		// new clients only after the reads above, so fds and clients stay lined up for them
+		if (fds[1].revents) {
+			for (int fd; (fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0;)
+				clients.push_back(Client{ fd });
+		}
+
+		if (!round.empty()) {
+			// picked up between rounds, so a round never mixes two catalogs
+			if (watcher.generation() != generation) {
+				generation = watcher.generation();
+				catalog = watcher.current();
+				cache = make_unique<StageCache>(1 << 18);
+				solutions = openSolutions();
+			}
+
+			workers.run(round.size(), [&](size_t i, int worker) {
+				const SolveContext context{ catalog->engines, 1, nullptr, cache.get(), nullptr, &arenas[worker] };
+				answer(round[i], context, options.solver, solutions.get());
+			}, 1);
+
+			rounds++;
+			largestRound = max(largestRound, round.size());
+
+			for (auto& request : round) {
+				if (request.stats) {
+					request.answer = json{
+						{ "requests", served }, { "rounds", rounds }, { "largestRound", largestRound },
+						{ "p50Us", latencies.percentile(0.5) }, { "p99Us", latencies.percentile(0.99) },
+						{ "engines", catalog->engines.size() }, { "cacheHits", cache->hits() }, { "cacheMisses", cache->misses() },
+						{ "solutionHits", solutions ? solutions->hits() : 0 }, { "solutionMisses", solutions ? solutions->misses() : 0 }
+					}.dump();
+				}
+
+				// queued rather than sent, so a client that stopped reading holds up nobody but itself
+				Client& client = clients[request.client];
+				if (client.closed) continue;
+
+				Dat::append32(client.outbox, request.answer.size());
+				client.outbox += request.answer;
+				client.unsent.emplace_back(client.outbox.size(), request.received);
+			}
+			round.clear();
+
+			for (auto& client : clients) {
+				if (!client.closed && !client.outbox.empty()) flush(client, latencies, served);
+				if (client.outbox.size() > maxOutbox) client.closed = true;
+			}
+		}
+
+		// only now, so no answer above could go to a new client that got a closed one's fd, and one
+		// that hung up goes once every answer it asked for is out
+		for (auto& client : clients) {
+			client.closed |= client.finished && client.outbox.empty();
+			if (client.closed) close(client.fd);
+		}
+		erase_if(clients, [](const Client& client) { return client.closed; });
+	}
+
+	for (const auto& client : clients) close(client.fd);
+	close(listener);
+	close(signalFd);
+	unlink(path.c_str());
+
+	return 0;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+
+#include "batch.hpp"
+
+using namespace std;
+
+namespace KSP {
+	struct ServeOptions {
+		string enginePath = "partdata/engines.dat";
+		string solutions; // a SolutionCache file, none when empty
+
+		BatchSolver solver = BatchSolver::Split; // for requests that don't name one, the quickest
+		int threads = 1;
+	};
+
+	// Answers solve requests on a Unix domain socket at `path` until SIGINT or SIGTERM. The engine
+	// catalog and stage cache (and solution cache, when there is one) stay loaded between requests,
+	// and the catalog reloads itself like the GUI's does.
+	//
+	// Every message either way is a u32 little endian length and then that many bytes. A body
+	// starting with '{' is a JSON mission, the same record --batch reads plus an optional
+	// "solver", and gets a JSON answer: the batch result without "line". {"stats": true} gets
+	// request counts and latency percentiles instead. Otherwise the body is binary, every field
+	// little endian:
+	//
+	//   request  char[4] "RKQ1", u32 solver (0 exact, 1 sweep, 2 split), u32 stage count n,
+	//            u32 max engines, f64 payload, f64 delta-v, f64 gravity, f64 decoupler mass,
+	//            f64 atm[n], f64 twr[n] (bottom stage first)
+	//   answer   char[4] "RKA1", u32 status, then when it's 0: f64 mass, u32 stage count, and per
+	//            stage (top first) u32 engine count, f64 mass, u32 name length, the name;
+	//            otherwise u32 message length and the message
+	//
+	// Requests are taken in rounds: whatever arrived from every client while the last round was
+	// being solved is solved together, spread over `threads`, and answered in the order each
+	// client sent it. Answers a client isn't reading yet wait for it without holding up anyone
+	// else, up to 64 MiB before it gets dropped.
+	int runServer(const string& path, const ServeOptions& options);
+};
@@ -0,0 +1,280 @@
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "solutions.hpp"
+#include "datfile.hpp"
+
+using namespace std;
+using namespace KSP;
+
+namespace {
+	constexpr char magic[8] = { 'R', 'O', 'C', 'K', 'S', 'O', 'L', '\0' };
+	constexpr uint32_t version = 1;
+
+	// u32 size, u64 catalog, u64 key hash, u32 key size, then the key; u32 stage count and u64 checksum around the stages
+	constexpr size_t keyOffset = 24;
+	constexpr size_t smallestEntry = keyOffset + 4 + 8;
+
+	constexpr size_t inFresh = (size_t)1 << 63;
+
+	// -0.0 and 0.0 solve the same
+	double normal(double value) { return value + 0.0; }
+
+	string encodeKey(const SolutionKey& key) {
+		const MultiArgs& args = key.args;
+
+		string out;
+		for (double value : { args.payload, args.deltaV, args.gravity, args.decouplerMass, key.quantum }) Dat::append64(out, normal(value));
+		for (uint32_t value : { (uint32_t)args.stageCount, (uint32_t)args.maxEngines, key.solver, key.parameter, (uint32_t)key.tanks })
+			Dat::append32(out, value);
+
+		for (const auto* values : { &args.atm, &args.twr }) {
+			Dat::append32(out, values->size());
+			for (double value : *values) Dat::append64(out, normal(value));
+		}
+
+		return out;
+	}
+
+	void encodeStage(string& out, const Stage& stage) {
+		const Engine& engine = stage.engine;
+
+		Dat::append32(out, stage.count);
+		for (double value : { stage.mass, engine.mass, engine.vacIsp, engine.atmIsp, engine.vacThrust, engine.atmThrust }) Dat::append64(out, value);
+
+		Dat::append32(out, engine.name.size());
+		out += engine.name;
+
+		Dat::append32(out, stage.tanks.size());
+		for (const auto& [tank, count] : stage.tanks) {
+			Dat::append32(out, tank);
+			Dat::append32(out, count);
+		}
+	}
+
+	// reads fields off an entry, going no further than `end`; the checksum only says an entry
+	// was written whole, not that whoever wrote it got the sizes right
+	struct Reader {
+		const char* at;
+		const char* end;
+		bool ok = true;
+
+		const char* take(size_t size) {
+			if ((size_t)(end - at) < size) {
+				ok = false;
+				return nullptr;
+			}
+			return exchange(at, at + size);
+		}
+
+		uint32_t u32() {
+			const char* p = take(4);
+			return p ? Dat::get32(p) : 0;
+		}
+
+		double f64() {
+			const char* p = take(8);
+			return p ? Dat::get64(p) : 0.0;
+		}
+	};
+
+	bool decodeRocket(const char* entry, vector<Stage>& rocket) {
+		const size_t size = Dat::get32(entry);
+		Reader in{ entry + keyOffset + Dat::get32(entry + 20), entry + size - 8 };
+
+		const uint32_t count = in.u32();
+		if (!in.ok || count > size) return false;
+
+		vector<Stage> stages(count);
+		for (Stage& stage : stages) {
+			stage.count = in.u32();
+			stage.mass = in.f64();
+
+			Engine& engine = stage.engine;
+			engine.mass = in.f64();
+			engine.vacIsp = in.f64();
+			engine.atmIsp = in.f64();
+			engine.vacThrust = in.f64();
+			engine.atmThrust = in.f64();
+
+			const uint32_t length = in.u32();
+			if (const char* name = in.take(length)) engine.name.assign(name, length);
+
+			const uint32_t tanks = in.u32();
+			if (!in.ok || tanks > size) return false;
+			stage.tanks.resize(tanks);
+			for (auto& [tank, n] : stage.tanks) {
+				tank = in.u32();
+				n = in.u32();
+			}
+
+			if (!in.ok) return false;
+		}
+
+		rocket = move(stages);
+		return true;
+	}
+};
+
+KSP::SolutionCache::SolutionCache(const string& path, uint64_t catalog) : path(path), catalog(catalog) {
+	if (!open()) return;
+
+	// an entry cut short hides everything appended after it, so that goes right away; entries
+	// for other catalogs only once they're most of the file
+	const size_t dead = mappedSize - Dat::headerSize - liveSize;
+	if (validSize < mappedSize || dead > liveSize) compact();
+}
+
+KSP::SolutionCache::~SolutionCache() {
+	unmap();
+}
+
+void KSP::SolutionCache::unmap() {
+	if (mapping) munmap((void*)mapping, mappedSize);
+	if (fd >= 0) ::close(fd);
+
+	fd = -1;
+	mapping = nullptr;
+	mappedSize = liveSize = validSize = 0;
+	index.clear();
+	fresh.clear();
+}
+
+bool KSP::SolutionCache::open() {
+	fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	if (fd < 0) return false;
+
+	struct stat info;
+	char header[Dat::headerSize] = {};
+	const bool readable = fstat(fd, &info) == 0 && pread(fd, header, min((size_t)info.st_size, Dat::headerSize), 0) >= 0;
+
+	// empty, ours but from another version, or never finished: start over. Anything else is
+	// some other file and stays untouched.
+	const size_t size = readable ? info.st_size : 0;
+	if (!readable || memcmp(header, magic, min(size, sizeof(magic))) != 0) {
+		unmap();
+		return false;
+	}
+
+	if (size < Dat::headerSize || Dat::get32(header + 8) != version || Dat::get32(header + 12) != Dat::headerSize) {
+		memset(header, 0, sizeof(header));
+		memcpy(header, magic, sizeof(magic));
+		Dat::put32(header + 8, version);
+		Dat::put32(header + 12, Dat::headerSize);
+
+		if (ftruncate(fd, 0) != 0 || write(fd, header, sizeof(header)) != (ssize_t)sizeof(header)) {
+			unmap();
+			return false;
+		}
+		mappedSize = Dat::headerSize;
+	}
+	else mappedSize = size;
+
+	void* mapped = mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+	if (mapped == MAP_FAILED) {
+		mappedSize = 0;
+		unmap();
+		return false;
+	}
+	mapping = (const char*)mapped;
+
+	// up to the first entry that isn't whole
+	size_t offset = Dat::headerSize;
+	while (mappedSize - offset >= smallestEntry) {
+		const char* entry = mapping + offset;
+		const size_t length = Dat::get32(entry);
+		if (length < smallestEntry || length > mappedSize - offset) break;
+		if (Dat::get32(entry + 20) > length - smallestEntry) break;
+		if (Dat::getU64(entry + length - 8) != Dat::hash(entry, length - 8)) break;
+
+		if (Dat::getU64(entry + 4) == catalog) {
+			index.emplace(Dat::getU64(entry + 12), offset);
+			liveSize += length;
+		}
+		offset += length;
+	}
+	validSize = offset;
+
+	return true;
+}
+
+void KSP::SolutionCache::compact() {
+	vector<char> data(mapping, mapping + Dat::headerSize);
+	for (size_t offset = Dat::headerSize; offset < validSize;) {
+		const char* entry = mapping + offset;
+		const size_t length = Dat::get32(entry);
+		if (Dat::getU64(entry + 4) == catalog) data.insert(data.end(), entry, entry + length);
+		offset += length;
+	}
+
+	// renamed into place, so another process still mapping the old file keeps reading it whole
+	const bool written = Dat::writeFile(path, data);
+	unmap();
+	if (written) open();
+}
+
+bool KSP::SolutionCache::find(const SolutionKey& key, vector<Stage>& rocket) {
+	const string bytes = encodeKey(key);
+
+	{
+		lock_guard guard(lock);
+
+		auto [first, last] = index.equal_range(Dat::hash(bytes.data(), bytes.size()));
+		for (auto it = first; it != last; ++it) {
+			const char* entry = it->second & inFresh ? &fresh[it->second & ~inFresh] : mapping + it->second;
+			if (Dat::get32(entry + 20) != bytes.size() || memcmp(entry + keyOffset, bytes.data(), bytes.size()) != 0) continue;
+
+			if (decodeRocket(entry, rocket)) {
+				hitCount++;
+				return true;
+			}
+		}
+	}
+
+	missCount++;
+	return false;
+}
+
+void KSP::SolutionCache::insert(const SolutionKey& key, const vector<Stage>& rocket) {
+	if (rocket.empty() || any_of(rocket.begin(), rocket.end(), [](const Stage& stage) { return !stage.feasible(); })) return;
+
+	const string bytes = encodeKey(key);
+	const uint64_t keyHash = Dat::hash(bytes.data(), bytes.size());
+
+	string entry;
+	Dat::append32(entry, 0); // the size, once it's known
+	Dat::appendU64(entry, catalog);
+	Dat::appendU64(entry, keyHash);
+	Dat::append32(entry, bytes.size());
+	entry += bytes;
+
+	Dat::append32(entry, rocket.size());
+	for (const Stage& stage : rocket) encodeStage(entry, stage);
+
+	Dat::put32(entry.data(), entry.size() + 8);
+	Dat::appendU64(entry, Dat::hash(entry.data(), entry.size()));
+
+	lock_guard guard(lock);
+	if (fd < 0) return;
+
+	auto [first, last] = index.equal_range(keyHash);
+	for (auto it = first; it != last; ++it) {
+		const char* existing = it->second & inFresh ? &fresh[it->second & ~inFresh] : mapping + it->second;
+		if (Dat::get32(existing + 20) == bytes.size() && memcmp(existing + keyOffset, bytes.data(), bytes.size()) == 0) return;
+	}
+
+	// one write, so an entry from another process never lands in the middle of this one; one
+	// that fails halfway gets cut off the next time the file is opened
+	(void)!write(fd, entry.data(), entry.size());
+
+	index.emplace(keyHash, inFresh | fresh.size());
+	fresh.insert(fresh.end(), entry.begin(), entry.end());
+}
+
+size_t KSP::SolutionCache::size() const {
+	lock_guard guard(lock);
+	return index.size();
+}
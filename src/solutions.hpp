@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ksp.hpp"
+
+using namespace std;
+
+namespace KSP {
+	// What a finished rocket depends on besides the catalog. Solvers are numbered like the GUI's
+	// list and BatchSolver (0 sweep, 1 exact, 2 split), `parameter` is their iterations, bins or
+	// evaluations and `quantum` the stage cache grid they ran with, 0 without one.
+	struct SolutionKey {
+		MultiArgs args;
+		uint32_t solver;
+		uint32_t parameter;
+		double quantum;
+		bool tanks;
+
+		bool operator==(const SolutionKey&) const = default;
+	};
+
+	// Finished multi stage rockets kept on disk across runs, for a single catalog (`catalog`, a
+	// Catalog::hash). The file is an append only log that gets mapped on open:
+	//
+	//   header   char magic[8] "ROCKSOL\0", u32 version, u32 header size, 16 bytes reserved
+	//   entries  u32 entry size, u64 catalog hash, u64 key hash, u32 key size, the key,
+	//            u32 stage count, the stages, u64 checksum of everything before it
+	//
+	// with every field little endian. A key is every field of its MultiArgs (atm and twr bottom
+	// stage first) plus the rest of SolutionKey, a stage is the whole Engine, count, mass and
+	// tank list, so nothing in here points into a catalog. Entries for other catalogs are never
+	// returned, which is what invalidates everything once engines.dat changes, and opening
+	// rewrites the file without them once they're most of it, or straight away after a crash
+	// left an entry cut short. Several processes can share a file: each appends whole entries
+	// in single writes and sees the others' on its next open, though one appended while
+	// another process rewrites the file can get lost. Thread safe.
+	class SolutionCache {
+	public:
+		SolutionCache(const string& path, uint64_t catalog);
+		~SolutionCache();
+
+		SolutionCache(const SolutionCache&) = delete;
+		SolutionCache& operator=(const SolutionCache&) = delete;
+
+		bool find(const SolutionKey& key, vector<Stage>& rocket);
+		void insert(const SolutionKey& key, const vector<Stage>& rocket); // only feasible rockets are kept
+
+		bool valid() const { return fd >= 0; } // false if the file couldn't be opened, nothing is kept then
+		size_t size() const;
+		size_t hits() const { return hitCount; }
+		size_t misses() const { return missCount; }
+
+	private:
+		bool open(); // maps the file and indexes this catalog's entries
+		void compact(); // rewrites the file with only those, then opens it again
+		void unmap();
+
+		const string path;
+		const uint64_t catalog;
+
+		int fd = -1;
+		const char* mapping = nullptr;
+		size_t mappedSize = 0;
+		size_t liveSize = 0; // bytes of this catalog's entries in the mapping
+		size_t validSize = 0; // where the last whole entry in the mapping ends
+
+		// key hash to where its entry starts: in the mapping, or (with the top bit set) in `fresh`
+		unordered_multimap<uint64_t, size_t> index;
+		vector<char> fresh; // entries appended since the file was mapped
+
+		mutable mutex lock;
+		atomic<size_t> hitCount = 0;
+		atomic<size_t> missCount = 0;
+	};
+};
@@ -0,0 +1,1065 @@
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ROCK_X86
+#endif
+
+#include "solver.hpp"
+#include "parallel.hpp"
+
+using namespace std;
+using namespace KSP;
+
+// EngineTable
+
+namespace {
+	// the columns a runtime built table points into
+	struct Columns {
+		shared_ptr<const void> nameStorage;
+		vector<string_view> names;
+
+		vector<double> mass, vacIsp, atmIsp, vacThrust, atmThrust, tankRatio;
+	};
+}
+
+KSP::EngineTable::EngineTable(const vector<Engine>& engines, double tankRatio) {
+	// every name in one block, so the table makes a single allocation for them
+	string block;
+	for (const auto& engine : engines) block += engine.name;
+	auto names = make_shared<const string>(move(block));
+
+	vector<StaticEngine> rows;
+	rows.reserve(engines.size() + 1);
+
+	size_t offset = 0;
+	for (const auto& engine : engines) {
+		rows.push_back({ string_view(*names).substr(offset, engine.name.size()), engine.mass, engine.vacIsp, engine.atmIsp, engine.vacThrust, engine.atmThrust, tankRatio });
+		offset += engine.name.size();
+	}
+
+	build(move(rows), move(names));
+}
+
+KSP::EngineTable::EngineTable(shared_ptr<const EngineFile> file, double tankRatio) {
+	vector<StaticEngine> rows;
+	rows.reserve(file->size() + 1);
+
+	for (size_t i = 0; i < file->size(); i++) {
+		const EngineRecord& engine = file->record(i);
+		rows.push_back({ file->name(i), engine.mass, engine.vacIsp, engine.atmIsp, engine.vacThrust, engine.atmThrust, tankRatio });
+	}
+
+	build(move(rows), move(file));
+}
+
+void KSP::EngineTable::build(vector<StaticEngine> rows, shared_ptr<const void> nameStorage) {
+	rows.push_back(nerv); // nerv time baby
+
+	stable_sort(rows.begin(), rows.end(), [](const StaticEngine& a, const StaticEngine& b) { return a.mass < b.mass; });
+
+	auto columns = make_shared<Columns>();
+	columns->nameStorage = move(nameStorage);
+	for (auto* column : { &columns->mass, &columns->vacIsp, &columns->atmIsp, &columns->vacThrust, &columns->atmThrust, &columns->tankRatio }) column->reserve(rows.size());
+	columns->names.reserve(rows.size());
+
+	for (const auto& row : rows) {
+		columns->names.push_back(row.name);
+		columns->mass.push_back(row.mass);
+		columns->vacIsp.push_back(row.vacIsp);
+		columns->atmIsp.push_back(row.atmIsp);
+		columns->vacThrust.push_back(row.vacThrust);
+		columns->atmThrust.push_back(row.atmThrust);
+		columns->tankRatio.push_back(row.tankRatio);
+
+		bestVacIsp = max(bestVacIsp, row.vacIsp);
+		bestAtmIsp = max(bestAtmIsp, row.atmIsp);
+		lightestTankRatio = min(lightestTankRatio, row.tankRatio);
+	}
+
+	names = columns->names;
+	mass = columns->mass;
+	vacIsp = columns->vacIsp;
+	atmIsp = columns->atmIsp;
+	vacThrust = columns->vacThrust;
+	atmThrust = columns->atmThrust;
+	tankRatio = columns->tankRatio;
+
+	storage = move(columns);
+}
+
+KSP::Engine KSP::EngineTable::operator[](size_t i) const {
+	return Engine{ string(names[i]), mass[i], vacIsp[i], atmIsp[i], vacThrust[i], atmThrust[i] };
+}
+
+KSP::Stage KSP::EngineTable::stage(const StagePick& pick, const TankSolver* tanks) const {
+	if (!pick.feasible()) return Stage{};
+
+	Stage stage{ (*this)[pick.engine], pick.count, pick.mass };
+	if (tanks) stage.tanks = tanks->solve(pick.R, pick.fixedMass).tanks; // the same snapped query, so the same stack
+
+	return stage;
+}
+
+// Progress
+
+void KSP::Progress::offer(const vector<Stage>& rocket) {
+	if (rocket.empty() || !rocket.back().feasible()) return;
+
+	lock_guard guard(lock);
+	if (bestRocket.empty() || rocket.back().mass < bestRocket.back().mass) {
+		bestRocket = rocket;
+		bestMass = rocket.back().mass;
+	}
+}
+
+void KSP::Progress::set(vector<Stage> rocket) {
+	lock_guard guard(lock);
+	bestMass = !rocket.empty() && rocket.back().feasible() ? rocket.back().mass : __DBL_MAX__;
+	bestRocket = move(rocket);
+}
+
+vector<KSP::Stage> KSP::Progress::best() const {
+	lock_guard guard(lock);
+	return bestRocket;
+}
+
+void KSP::Progress::setFront(vector<vector<Stage>> rockets) {
+	lock_guard guard(lock);
+	frontRockets = move(rockets);
+}
+
+vector<vector<KSP::Stage>> KSP::Progress::front() const {
+	lock_guard guard(lock);
+	return frontRockets;
+}
+
+// SolveArena
+
+void KSP::SolveArena::reset() {
+	// next time everything fits in one block, however many the last solve took
+	if (blocks.size() > 1) {
+		size_t total = 0;
+		for (const auto& block : blocks) total += block.size;
+
+		blocks.clear();
+		blocks.push_back(Block{ make_unique<byte[]>(total), total });
+	}
+
+	used = 0;
+}
+
+void* KSP::SolveArena::grab(size_t bytes, size_t align) {
+	size_t offset = (used + align - 1) / align * align;
+
+	if (blocks.empty() || offset + bytes > blocks.back().size) {
+		const size_t size = max({ bytes, blocks.empty() ? 0 : blocks.back().size * 2, (size_t)4096 });
+		blocks.push_back(Block{ make_unique<byte[]>(size), size });
+		offset = 0;
+	}
+
+	used = offset + bytes;
+	return blocks.back().data.get() + offset;
+}
+
+// Stage search
+
+namespace {
+	struct Pick {
+		size_t index;
+		int count;
+		double mass;
+
+		size_t pruned = 0;
+	};
+
+	// No stage can come in under its payload plus one engine, pushed by the best Isp in the table
+	// on the lightest tanks in it. That only grows with engine mass, and the table is sorted by it,
+	// so the first engine whose floor can't beat the incumbent rules out every engine after it too.
+	struct Bound {
+		double multiplier = 0.0; // 0 when no bound holds for these args
+
+		Bound(const EngineTable& engines, const Args& args) {
+			if (args.atm < 0.0 || args.atm > 1.0) return; // extrapolated Isp, the table maximums mean nothing
+			if (args.twr < 0.0 || args.gravity < 0.0) return; // "negative" stages can win here, stay exhaustive
+
+			const double isp = lerp(engines.bestVacIsp, engines.bestAtmIsp, args.atm);
+			const double R = exp(args.deltaV / (isp * 9.81));
+			const double ratio = engines.lightestTankRatio;
+			const double denominator = ratio + 1.0 - R * ratio;
+
+			// shaved a hair so rounding can never make the floor land above a real stage
+			if (isp > 0.0 && denominator > 0.0) multiplier = R / denominator * (1.0 - 1e-12);
+		}
+
+		bool rulesOut(double payload, double engineMass, double incumbent) const {
+			return multiplier > 0.0 && (payload + engineMass) * multiplier >= incumbent;
+		}
+	};
+
+	// FANCY rocket equation solving for fuel mass
+	inline double stageMass(double R, double ratio, double payload) {
+		const double fuelMass = (R - 1) * payload / (ratio + 1.0 - R * ratio);
+		return (ratio + 1.0) * fuelMass + payload;
+	}
+
+	inline bool lifts(int count, double thrust, double totalMass, const Args& args) {
+		return !(count * thrust / (totalMass * args.gravity) < args.twr);
+	}
+
+	// Fewest engines, up to args.maxEngines, that hold the TWR, or 0 if no count does. Stage mass
+	// is linear in the count, M * (payload + n * engineMass) with M = R / (1 + ratio - R * ratio),
+	// so n * thrust >= twr * g * M * (payload + n * engineMass) solves for n directly.
+	int minCount(double R, double ratio, double engineMass, double thrust, const Args& args) {
+		const int cap = args.maxEngines;
+		auto liftsWith = [&](int n) { return lifts(n, thrust, stageMass(R, ratio, engineMass * n + args.payload), args); };
+
+		// tanks too heavy to ever get there, no count carries the fuel
+		const double denominator = ratio + 1.0 - R * ratio;
+		if (!(denominator > 0.0 && isfinite(R))) return 0;
+
+		// no gravity, no TWR asked for or no thrust: more engines never lift any better than one
+		if (!(args.gravity > 0.0 && args.twr > 0.0 && thrust > 0.0)) return cap >= 1 && liftsWith(1) ? 1 : 0;
+
+		const double weight = args.twr * args.gravity * R / denominator; // thrust needed per tonne of payload
+		const double spare = thrust - weight * engineMass; // left over once an engine has lifted itself and its tanks
+		int n = spare > 0.0 ? (int)clamp(ceil(weight * args.payload / spare), 1.0, cap + 1.0) : cap + 1;
+
+		// rounding can leave the estimate a count off, settle it against the exact check
+		while (n > 1 && liftsWith(n - 1)) n--;
+		while (n <= cap && !liftsWith(n)) n++;
+
+		return n <= cap ? n : 0;
+	}
+
+	// lightest engine in [begin, end), only an engine strictly lighter than `best` replaces it
+	Pick pickScalar(const EngineTable& engines, const Args& args, const Bound& bound, size_t begin, size_t end, Pick best) {
+		for (size_t e = begin; e < end; e++) {
+			if (bound.rulesOut(args.payload, engines.mass[e], best.mass)) {
+				best.pruned += end - e;
+				break;
+			}
+
+			const double isp = lerp(engines.vacIsp[e], engines.atmIsp[e], args.atm);
+			const double thrust = lerp(engines.vacThrust[e], engines.atmThrust[e], args.atm);
+			const double ratio = engines.tankRatio[e];
+
+			const double R = exp(args.deltaV / (isp * 9.81));
+
+			// more engines only make it heavier, so if one can't beat the incumbent no count will
+			const double lightest = stageMass(R, ratio, engines.mass[e] + args.payload);
+			if (lightest >= best.mass && lightest > 0.0) {
+				best.pruned++;
+				continue;
+			}
+
+			const int count = minCount(R, ratio, engines.mass[e], thrust, args);
+			if (count == 0) continue;
+
+			const double totalMass = stageMass(R, ratio, engines.mass[e] * count + args.payload);
+			if (totalMass < best.mass) best = Pick{ e, count, totalMass, best.pruned };
+		}
+
+		return best;
+	}
+
+#ifdef ROCK_X86
+	// exp for 4 doubles: split x into n*ln2 + r with |r| <= ln2/2, take a degree 12 Taylor
+	// polynomial of e^r (under an ulp of error on that range) and scale it by 2^n
+	__attribute__((target("avx2,fma")))
+	inline __m256d exp4(__m256d x) {
+		x = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(-708.0)), _mm256_set1_pd(709.0));
+
+		const __m256d n = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(1.4426950408889634)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+		__m256d r = _mm256_fnmadd_pd(n, _mm256_set1_pd(6.93147180369123816490e-01), x);
+		r = _mm256_fnmadd_pd(n, _mm256_set1_pd(1.90821492927058770002e-10), r);
+
+		constexpr double coeffs[] = {
+			1.0 / 479001600.0, 1.0 / 39916800.0, 1.0 / 3628800.0, 1.0 / 362880.0, 1.0 / 40320.0, 1.0 / 5040.0,
+			1.0 / 720.0, 1.0 / 120.0, 1.0 / 24.0, 1.0 / 6.0, 1.0 / 2.0, 1.0, 1.0
+		};
+		__m256d p = _mm256_set1_pd(coeffs[0]);
+		for (size_t i = 1; i < size(coeffs); i++) p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(coeffs[i]));
+
+		// 2^n straight into the exponent bits
+		const __m256i bits = _mm256_slli_epi64(_mm256_add_epi64(_mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n)), _mm256_set1_epi64x(1023)), 52);
+		return _mm256_mul_pd(p, _mm256_castsi256_pd(bits));
+	}
+
+	__attribute__((target("avx2,fma")))
+	inline __m256d stageMass4(__m256d fuelPerPayload, __m256d ratioPlusOne, __m256d engineMass, __m256d count, __m256d payload) {
+		const __m256d stagePayload = _mm256_fmadd_pd(engineMass, count, payload);
+		return _mm256_fmadd_pd(ratioPlusOne, _mm256_mul_pd(fuelPerPayload, stagePayload), stagePayload);
+	}
+
+	// written as "not less than" so NaNs pass exactly like the scalar check
+	__attribute__((target("avx2,fma")))
+	inline __m256d lifts4(__m256d count, __m256d thrust, __m256d totalMass, __m256d gravity, __m256d twr) {
+		return _mm256_cmp_pd(_mm256_div_pd(_mm256_mul_pd(count, thrust), _mm256_mul_pd(totalMass, gravity)), twr, _CMP_NLT_UQ);
+	}
+
+	// same search as pickScalar, four engines per lane group
+	__attribute__((target("avx2,fma")))
+	Pick pickAvx2(const EngineTable& engines, const Args& args, const Bound& bound) {
+		const size_t whole = engines.size() & ~size_t(3);
+
+		const __m256d atm = _mm256_set1_pd(args.atm);
+		const __m256d deltaV = _mm256_set1_pd(args.deltaV);
+		const __m256d payload = _mm256_set1_pd(args.payload);
+		const __m256d gravity = _mm256_set1_pd(args.gravity);
+		const __m256d twr = _mm256_set1_pd(args.twr);
+		const __m256d one = _mm256_set1_pd(1.0);
+		const __m256d zero = _mm256_setzero_pd();
+		const __m256d pastCap = _mm256_set1_pd(args.maxEngines + 1.0);
+
+		// outside this minCount settles on one engine or none, so let it handle the whole group
+		const bool regularArgs = args.gravity > 0.0 && args.twr > 0.0;
+		const __m256d twrWeight = _mm256_set1_pd(args.twr * args.gravity);
+
+		__m256d bestMass = _mm256_set1_pd(__DBL_MAX__);
+		__m256d bestIndex = _mm256_setzero_pd();
+		__m256d bestCount = _mm256_setzero_pd();
+
+		// lightest stage over every lane so far, what the bounds get checked against
+		double incumbent = __DBL_MAX__;
+		size_t pruned = 0;
+
+		size_t e = 0;
+		for (; e < whole; e += 4) {
+			if (bound.rulesOut(args.payload, engines.mass[e], incumbent)) break;
+
+			const __m256d vacIsp = _mm256_loadu_pd(&engines.vacIsp[e]);
+			const __m256d vacThrust = _mm256_loadu_pd(&engines.vacThrust[e]);
+			const __m256d isp = _mm256_fmadd_pd(atm, _mm256_sub_pd(_mm256_loadu_pd(&engines.atmIsp[e]), vacIsp), vacIsp);
+			const __m256d thrust = _mm256_fmadd_pd(atm, _mm256_sub_pd(_mm256_loadu_pd(&engines.atmThrust[e]), vacThrust), vacThrust);
+			const __m256d mass = _mm256_loadu_pd(&engines.mass[e]);
+			const __m256d ratio = _mm256_loadu_pd(&engines.tankRatio[e]);
+			const __m256d ratioPlusOne = _mm256_add_pd(ratio, one);
+
+			const __m256d R = exp4(_mm256_div_pd(deltaV, _mm256_mul_pd(isp, _mm256_set1_pd(9.81))));
+			const __m256d denominator = _mm256_fnmadd_pd(R, ratio, ratioPlusOne);
+			const __m256d fuelPerPayload = _mm256_div_pd(_mm256_sub_pd(R, one), denominator);
+
+			// more engines only make it heavier, so if one can't beat the incumbent no count will
+			const __m256d lightest = stageMass4(fuelPerPayload, ratioPlusOne, mass, one, payload);
+			const __m256d beaten = _mm256_and_pd(_mm256_cmp_pd(lightest, _mm256_set1_pd(incumbent), _CMP_GE_OQ), _mm256_cmp_pd(lightest, zero, _CMP_GT_OQ));
+			pruned += __builtin_popcount(_mm256_movemask_pd(beaten));
+
+			// the same closed form as minCount, kept only where it survives the exact check
+			__m256d count = pastCap;
+			__m256d settled = zero;
+			if (regularArgs) {
+				const __m256d weight = _mm256_div_pd(_mm256_mul_pd(twrWeight, R), denominator);
+				const __m256d spare = _mm256_fnmadd_pd(weight, mass, thrust);
+				const __m256d estimate = _mm256_ceil_pd(_mm256_div_pd(_mm256_mul_pd(weight, payload), spare));
+				count = _mm256_blendv_pd(pastCap, _mm256_min_pd(_mm256_max_pd(estimate, one), pastCap), _mm256_cmp_pd(spare, zero, _CMP_GT_OQ));
+
+				const __m256d regular = _mm256_and_pd(
+					_mm256_and_pd(_mm256_cmp_pd(denominator, zero, _CMP_GT_OQ), _mm256_cmp_pd(thrust, zero, _CMP_GT_OQ)),
+					_mm256_cmp_pd(R, _mm256_set1_pd(__DBL_MAX__), _CMP_LE_OQ));
+
+				const __m256d below = _mm256_sub_pd(count, one);
+				const __m256d belowLifts = _mm256_and_pd(_mm256_cmp_pd(below, zero, _CMP_GT_OQ),
+					lifts4(below, thrust, stageMass4(fuelPerPayload, ratioPlusOne, mass, below, payload), gravity, twr));
+				const __m256d countLifts = _mm256_or_pd(_mm256_cmp_pd(count, pastCap, _CMP_EQ_OQ),
+					lifts4(count, thrust, stageMass4(fuelPerPayload, ratioPlusOne, mass, count, payload), gravity, twr));
+
+				settled = _mm256_and_pd(regular, _mm256_andnot_pd(belowLifts, countLifts));
+			}
+
+			// anything the estimate got wrong, or that can't fly at all, goes through minCount lane by lane
+			const int unsettled = ~_mm256_movemask_pd(_mm256_or_pd(settled, beaten)) & 0xF;
+			if (unsettled) {
+				double counts[4], Rs[4], thrusts[4];
+				_mm256_storeu_pd(counts, count);
+				_mm256_storeu_pd(Rs, R);
+				_mm256_storeu_pd(thrusts, thrust);
+
+				for (int l = 0; l < 4; l++) {
+					if (!(unsettled & (1 << l))) continue;
+
+					const int n = minCount(Rs[l], engines.tankRatio[e + l], engines.mass[e + l], thrusts[l], args);
+					counts[l] = n ? n : args.maxEngines + 1.0;
+				}
+
+				count = _mm256_loadu_pd(counts);
+			}
+
+			const __m256d feasible = _mm256_andnot_pd(beaten, _mm256_cmp_pd(count, pastCap, _CMP_LT_OQ));
+			const __m256d groupMass = _mm256_blendv_pd(_mm256_set1_pd(__DBL_MAX__), stageMass4(fuelPerPayload, ratioPlusOne, mass, count, payload), feasible);
+
+			const __m256d better = _mm256_cmp_pd(groupMass, bestMass, _CMP_LT_OQ);
+			bestMass = _mm256_blendv_pd(bestMass, groupMass, better);
+			bestCount = _mm256_blendv_pd(bestCount, count, better);
+			bestIndex = _mm256_blendv_pd(bestIndex, _mm256_setr_pd(e, e + 1, e + 2, e + 3), better);
+
+			__m128d groupBest = _mm_min_pd(_mm256_castpd256_pd128(groupMass), _mm256_extractf128_pd(groupMass, 1));
+			groupBest = _mm_min_sd(groupBest, _mm_unpackhi_pd(groupBest, groupBest));
+			incumbent = min(incumbent, _mm_cvtsd_f64(groupBest));
+		}
+
+		// each lane only ever saw increasing indices, so ties between lanes go to the lowest index
+		double masses[4], indices[4], counts[4];
+		_mm256_storeu_pd(masses, bestMass);
+		_mm256_storeu_pd(indices, bestIndex);
+		_mm256_storeu_pd(counts, bestCount);
+
+		Pick best{ 0, 0, __DBL_MAX__ };
+		for (int l = 0; l < 4; l++) {
+			if (masses[l] < best.mass || (masses[l] == best.mass && masses[l] != __DBL_MAX__ && indices[l] < best.index))
+				best = Pick{ (size_t)indices[l], (int)counts[l], masses[l] };
+		}
+
+		if (e < whole) { // the bound ruled out the rest of the table
+			best.pruned = pruned + engines.size() - e;
+			return best;
+		}
+
+		best.pruned = pruned;
+		return pickScalar(engines, args, bound, whole, engines.size(), best);
+	}
+
+	const bool hasAvx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+};
+
+namespace {
+	// The decoupler rides along like payload until the stage drops it, so the search treats it
+	// as payload and a stage's mass includes its decoupler.
+	Args withDecoupler(Args args) {
+		args.payload += args.decouplerMass;
+		args.decouplerMass = 0.0;
+
+		return args;
+	}
+}
+
+StagePick pickOptimalStage(const EngineTable& engines, Args args, size_t* pruned) {
+	args = withDecoupler(args);
+
+	const Bound bound(engines, args);
+	Pick best{ 0, 0, __DBL_MAX__ };
+
+#ifdef ROCK_X86
+	if (hasAvx2) best = pickAvx2(engines, args, bound);
+	else
+#endif
+	best = pickScalar(engines, args, bound, 0, engines.size(), best);
+
+	if (pruned) *pruned = best.pruned;
+
+	if (best.count == 0) return StagePick{}; // nothing can lift the payload
+
+	return StagePick{ (uint32_t)best.index, best.count, best.mass };
+}
+
+// The lightest stage built from real tanks. A stage on continuous fuel at the lightest tank ratio
+// can only weigh less than a real stack for the same engines, so it bounds every engine and
+// count before any tanks get solved, and engines go lightest bound first so the rest can be cut.
+StagePick pickDiscreteStage(const EngineTable& engines, const TankSolver& tanks, Args args, size_t* pruned) {
+	args = withDecoupler(args);
+
+	struct Candidate {
+		double bound;
+		size_t index;
+		int count; // fewest engines that could hold the TWR on continuous fuel
+		double R, ratio, thrust;
+	};
+
+	thread_local vector<Candidate> candidates; // reused, this runs for every stage evaluated
+	candidates.clear();
+	for (size_t e = 0; e < engines.size(); e++) {
+		if (engines.names[e] == nerv.name) continue; // burns LF only, real tanks all carry oxidizer
+
+		const double isp = lerp(engines.vacIsp[e], engines.atmIsp[e], args.atm);
+		const double thrust = lerp(engines.vacThrust[e], engines.atmThrust[e], args.atm);
+		const double R = exp(args.deltaV / (isp * 9.81));
+		const double ratio = min(engines.tankRatio[e], tanks.ratio());
+
+		const int count = minCount(R, ratio, engines.mass[e], thrust, args);
+		if (count == 0) continue;
+
+		const double bound = stageMass(R, ratio, engines.mass[e] * count + args.payload);
+		if (bound > 0.0) candidates.push_back(Candidate{ bound, e, count, R, ratio, thrust });
+	}
+
+	stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.bound < b.bound; });
+
+	StagePick best;
+	size_t ruledOut = engines.size() - candidates.size();
+
+	for (size_t c = 0; c < candidates.size(); c++) {
+		const Candidate& candidate = candidates[c];
+		if (candidate.bound >= best.mass) {
+			ruledOut += candidates.size() - c;
+			break;
+		}
+
+		// more engines only ever need more tanks, so the first count that lifts is this engine's best,
+		// and once another engine doesn't lift any better the stack outgrows the thrust from there
+		double lift = 0.0;
+		for (int n = candidate.count; n <= args.maxEngines; n++) {
+			const double fixedMass = engines.mass[candidate.index] * n + args.payload;
+			if (stageMass(candidate.R, candidate.ratio, fixedMass) >= best.mass) break;
+
+			const TankStack stack = tanks.solve(candidate.R, fixedMass);
+			if (!stack.feasible || fixedMass + stack.mass() >= best.mass) break;
+
+			const double totalMass = fixedMass + stack.mass();
+			if (lifts(n, candidate.thrust, totalMass, args)) {
+				best = StagePick{ (uint32_t)candidate.index, n, totalMass, candidate.R, fixedMass };
+				break;
+			}
+
+			if (n * candidate.thrust / totalMass <= lift) break;
+			lift = n * candidate.thrust / totalMass;
+		}
+	}
+
+	if (pruned) *pruned = ruledOut;
+
+	return best;
+}
+
+Stage findOptimalStage(const EngineTable& engines, const Args& args, size_t* pruned) {
+	return engines.stage(pickOptimalStage(engines, args, pruned));
+}
+
+Stage findDiscreteStage(const EngineTable& engines, const TankSolver& tanks, const Args& args, size_t* pruned) {
+	return engines.stage(pickDiscreteStage(engines, tanks, args, pruned), &tanks);
+}
+
+namespace {
+	// drops every option another one beats on both mass and engine count, leaving them sorted
+	// by mass so engine counts come out descending. Options come in engine order, so ties on
+	// mass going by engine keep them stable without stable_sort's buffer.
+	void keepFront(vector<StagePick>& options) {
+		sort(options.begin(), options.end(), [](const StagePick& a, const StagePick& b) { return tie(a.mass, a.engine) < tie(b.mass, b.engine); });
+
+		size_t kept = 0;
+		for (const auto& option : options)
+			if (kept == 0 || option.count < options[kept - 1].count) options[kept++] = option;
+		options.resize(kept);
+	}
+};
+
+// Every engine's lightest stage rather than just the overall lightest, minus any option another
+// one beats on both mass and engine count. `options` is cleared first, so a caller reusing it
+// between stages keeps its capacity.
+void pickStageOptions(const EngineTable& engines, Args args, vector<StagePick>& options) {
+	args = withDecoupler(args);
+	options.clear();
+
+	for (size_t e = 0; e < engines.size(); e++) {
+		const double isp = lerp(engines.vacIsp[e], engines.atmIsp[e], args.atm);
+		const double thrust = lerp(engines.vacThrust[e], engines.atmThrust[e], args.atm);
+		const double R = exp(args.deltaV / (isp * 9.81));
+
+		const int count = minCount(R, engines.tankRatio[e], engines.mass[e], thrust, args);
+		if (count == 0) continue;
+
+		const double totalMass = stageMass(R, engines.tankRatio[e], engines.mass[e] * count + args.payload);
+		options.push_back(StagePick{ (uint32_t)e, count, totalMass });
+	}
+
+	keepFront(options);
+}
+
+// The same on real tanks: each engine's fewest engines that lift on a real stack, counted up from
+// what continuous fuel at the lightest tank ratio would need.
+void pickDiscreteOptions(const EngineTable& engines, const TankSolver& tanks, Args args, vector<StagePick>& options) {
+	args = withDecoupler(args);
+	options.clear();
+
+	for (size_t e = 0; e < engines.size(); e++) {
+		if (engines.names[e] == nerv.name) continue; // burns LF only, real tanks all carry oxidizer
+
+		const double isp = lerp(engines.vacIsp[e], engines.atmIsp[e], args.atm);
+		const double thrust = lerp(engines.vacThrust[e], engines.atmThrust[e], args.atm);
+		const double R = exp(args.deltaV / (isp * 9.81));
+		const double ratio = min(engines.tankRatio[e], tanks.ratio());
+
+		const int count = minCount(R, ratio, engines.mass[e], thrust, args);
+		if (count == 0) continue;
+
+		// stops as soon as another engine doesn't lift any better, the stack outgrows the thrust from there
+		double lift = 0.0;
+		for (int n = count; n <= args.maxEngines; n++) {
+			const double fixedMass = engines.mass[e] * n + args.payload;
+			const TankStack stack = tanks.solve(R, fixedMass);
+			if (!stack.feasible) break;
+
+			const double totalMass = fixedMass + stack.mass();
+			if (lifts(n, thrust, totalMass, args)) {
+				options.push_back(StagePick{ (uint32_t)e, n, totalMass, R, fixedMass });
+				break;
+			}
+
+			if (n * thrust / totalMass <= lift) break;
+			lift = n * thrust / totalMass;
+		}
+	}
+
+	keepFront(options);
+}
+
+vector<Stage> findStageOptions(const EngineTable& engines, const Args& args) {
+	vector<StagePick> options;
+	pickStageOptions(engines, args, options);
+
+	vector<Stage> front;
+	for (const auto& option : options) front.push_back(engines.stage(option));
+
+	return front;
+}
+
+StagePick KSP::SolveContext::stage(const Args& args) const {
+	const Args snapped = cache ? cache->snap(withDecoupler(args)) : withDecoupler(args);
+
+	StagePick stage;
+	if (cache && cache->find(snapped, stage)) return stage;
+
+	size_t pruned = 0;
+	stage = tanks ? pickDiscreteStage(engines, *tanks, snapped, &pruned) : pickOptimalStage(engines, snapped, &pruned);
+	if (cache) cache->insert(snapped, stage);
+
+	if (progress) {
+		progress->candidates += engines.size();
+		progress->pruned += pruned;
+	}
+
+	return stage;
+}
+
+void KSP::SolveContext::stageOptions(const Args& args, vector<StagePick>& options) const {
+	const Args snapped = cache ? cache->snap(withDecoupler(args)) : withDecoupler(args);
+
+	if (cache && cache->findOptions(snapped, options)) return;
+
+	if (tanks) pickDiscreteOptions(engines, *tanks, snapped, options);
+	else pickStageOptions(engines, snapped, options);
+	if (cache) cache->insertOptions(snapped, options);
+
+	if (progress) progress->candidates += engines.size();
+}
+
+vector<Stage> KSP::SolveContext::rocket(span<const StagePick> picks) const {
+	vector<Stage> stages;
+	stages.reserve(picks.size());
+	for (const auto& pick : picks) stages.push_back(engines.stage(pick, tanks));
+
+	return stages;
+}
+
+void KSP::SolveContext::offer(span<const StagePick> picks) const {
+	if (!progress || picks.empty() || !picks.back().feasible() || picks.back().mass >= progress->lightest()) return;
+
+	progress->offer(rocket(picks));
+}
+
+// Multi stage search
+
+// Stage k from the top burns splits[k] of the delta-v the stages above it left over, the bottom
+// stage burns whatever is left after that.
+size_t fillSplitMulti(const SolveContext& context, const MultiArgs& args, span<const double> splits, span<StagePick> rocket) {
+	double payload = args.payload;
+	double deltaV = args.deltaV;
+
+	for (int k = 0; k < args.stageCount; k++) {
+		Args stageArgs = args.toArgs(k);
+		stageArgs.payload = payload;
+		stageArgs.deltaV = k < args.stageCount - 1 ? deltaV * clamp(splits[k], 0.0, 1.0) : deltaV;
+
+		rocket[k] = context.stage(stageArgs);
+		if (!rocket[k].feasible()) return k + 1; // nothing below can lift it either
+
+		// prepare next args
+		deltaV -= stageArgs.deltaV;
+		payload = rocket[k].mass;
+	}
+
+	return args.stageCount;
+}
+
+vector<Stage> findSplitMulti(const SolveContext& context, const MultiArgs& args, const vector<double>& splits) {
+	vector<StagePick> rocket(max(args.stageCount, 0));
+	rocket.resize(fillSplitMulti(context, args, splits, rocket));
+
+	return context.rocket(rocket);
+}
+
+vector<Stage> findRandomMulti(const SolveContext& context, const MultiArgs& args, double frac) {
+	return findSplitMulti(context, args, vector<double>(max(args.stageCount - 1, 0), frac));
+}
+
+// Tries `iterations` evenly spaced fractions. Every worker keeps its own best and the bests are
+// merged by mass and then fraction, so the winner never depends on how the work was split up.
+// Workers only ever write into their own slices of the arena, so past the arena nothing in here
+// allocates until the winner is turned into Stages.
+vector<Stage> sweepMulti(const SolveContext& context, const MultiArgs& args, int iterations) {
+	const size_t stages = max(args.stageCount, 0);
+	if (stages == 0) return {};
+
+	Progress* progress = context.progress;
+	const int threads = max(context.threads, 1);
+
+	SolveArena ownArena;
+	SolveArena& arena = context.arena ? *context.arena : ownArena;
+	arena.reset();
+
+	struct Best {
+		double mass = __DBL_MAX__;
+		size_t iteration = SIZE_MAX;
+	};
+	span<Best> bests = arena.take<Best>(threads);
+	span<StagePick> rockets = arena.take<StagePick>(threads * stages * 2); // each worker's current rocket, then its best
+	span<double> splits = arena.take<double>(threads * stages);
+
+	if (progress) progress->total = iterations;
+
+	parallelFor(iterations, threads, [&](size_t i, int worker) {
+		if (progress && progress->cancelled) return;
+
+		const span<StagePick> rocket = rockets.subspan(worker * stages * 2, stages);
+		const span<StagePick> bestRocket = rockets.subspan(worker * stages * 2 + stages, stages);
+		const span<double> split = splits.subspan(worker * stages, stages);
+		fill(split.begin(), split.end(), i / (double)iterations);
+
+		const size_t filled = fillSplitMulti(context, args, split, rocket);
+
+		Best& best = bests[worker];
+		if (filled == stages && rocket.back().feasible() && rocket.back().mass < best.mass) {
+			context.offer(rocket);
+			copy(rocket.begin(), rocket.end(), bestRocket.begin());
+			best = { rocket.back().mass, i };
+		}
+
+		if (progress) progress->done++;
+	});
+
+	int winner = -1;
+	for (int worker = 0; worker < threads; worker++) {
+		const Best& candidate = bests[worker];
+		if (candidate.iteration == SIZE_MAX) continue;
+
+		if (winner < 0 || candidate.mass < bests[winner].mass ||
+			(candidate.mass == bests[winner].mass && candidate.iteration < bests[winner].iteration))
+			winner = worker;
+	}
+
+	if (winner < 0) return {};
+
+	return context.rocket(rockets.subspan(winner * stages * 2 + stages, stages));
+}
+
+// Exact search over every split of delta-v into `bins` equal steps. A stage only ever gets
+// heavier as its payload does, so the lightest top k stages for some delta-v are always
+// the top of the lightest rocket, and we can build the rocket one stage at a time from the
+// top down: O(stageCount * bins^2) stage evaluations, independent of any sweep resolution.
+// Both rows and the table of picks live in the arena.
+size_t fillOptimalMulti(const SolveContext& context, const MultiArgs& args, int bins, span<StagePick> rocket) {
+	Progress* progress = context.progress;
+	const int stageCount = args.stageCount;
+	if (stageCount < 1 || bins < stageCount) return 0;
+
+	SolveArena ownArena;
+	SolveArena& arena = context.arena ? *context.arena : ownArena;
+	arena.reset();
+
+	const double step = args.deltaV / bins;
+	const size_t row = bins + 1;
+
+	// mass[d] is the lightest stack of the stages solved so far that gives d steps of delta-v,
+	// picks[k * row + d] is stage k of that stack along with how many steps it burns
+	struct Cell {
+		StagePick stage;
+		int steps = 0;
+	};
+	span<double> mass = arena.take<double>(row, __DBL_MAX__);
+	span<double> next = arena.take<double>(row);
+	span<Cell> picks = arena.take<Cell>(stageCount * row);
+
+	// one unit of progress per (stage, d) cell, the bottom stage only has the one
+	if (progress) progress->total = (stageCount - 1) * (bins - stageCount + 1) + 1;
+
+	for (int k = 0; k < stageCount; k++) {
+		const Args stageBase = args.toArgs(k);
+		fill(next.begin(), next.end(), __DBL_MAX__);
+
+		// every stage burns at least one step, and only the bottom stage has to hit the total
+		const int lowest = k == stageCount - 1 ? bins : k + 1;
+		const int highest = bins - (stageCount - 1 - k);
+
+		// each d only reads the previous stage's row, so they can all be solved at once
+		parallelFor(highest - lowest + 1, context.threads, [&](size_t i, int) {
+			if (progress && progress->cancelled) return;
+
+			const int d = lowest + (int)i;
+			Args stageArgs = stageBase;
+
+			// the top stage has nothing above it, so it takes all d steps itself
+			for (int j = k == 0 ? d : 1; j <= d - k; j++) {
+				stageArgs.payload = k == 0 ? args.payload : mass[d - j];
+				if (stageArgs.payload == __DBL_MAX__) continue;
+
+				stageArgs.deltaV = j * step;
+				const StagePick stage = context.stage(stageArgs);
+
+				if (stage.mass < next[d]) {
+					next[d] = stage.mass;
+					picks[k * row + d] = { stage, j };
+				}
+			}
+
+			if (progress) progress->done++;
+		});
+
+		if (progress && progress->cancelled) return 0;
+
+		swap(mass, next);
+	}
+
+	if (mass[bins] == __DBL_MAX__) return 0;
+
+	// walk back up from the bottom stage, peeling off the delta-v each stage took
+	for (int k = stageCount - 1, d = bins; k >= 0; k--) {
+		rocket[k] = picks[k * row + d].stage;
+		d -= picks[k * row + d].steps;
+	}
+
+	return stageCount;
+}
+
+vector<Stage> findOptimalMulti(const SolveContext& context, const MultiArgs& args, int bins) {
+	vector<StagePick> rocket(max(args.stageCount, 0));
+	if (fillOptimalMulti(context, args, bins, rocket) == 0) return {};
+
+	return context.rocket(rocket);
+}
+
+namespace {
+	struct Vertex {
+		span<double> point;
+		double mass;
+	};
+
+	// Everything Nelder-Mead works in for one seed, taken from the arena before any search starts.
+	struct Simplex {
+		span<Vertex> vertices; // n + 1 of them
+		span<double> centroid, reflected, expanded, contracted;
+
+		Simplex() = default;
+		Simplex(SolveArena& arena, size_t n) {
+			vertices = arena.take<Vertex>(n + 1);
+			for (auto& vertex : vertices) vertex.point = arena.take<double>(n);
+
+			centroid = arena.take<double>(n);
+			reflected = arena.take<double>(n);
+			expanded = arena.take<double>(n);
+			contracted = arena.take<double>(n);
+		}
+	};
+
+	void toward(span<const double> from, span<const double> to, double t, span<double> out) {
+		for (size_t i = 0; i < from.size(); i++) out[i] = clamp(from[i] + t * (to[i] - from[i]), 0.0, 1.0);
+	}
+
+	// Nelder-Mead inside the unit cube, working from mass comparisons alone. Stage mass jumps every
+	// time an engine count changes, so there is no gradient worth estimating, and a simplex that
+	// stalls on a step just shrinks until it either finds a way down or gets too small to matter.
+	// The best point ends up in `best`, which may be `start` itself.
+	template<class F>
+	double nelderMead(F&& f, span<const double> start, double size, int budget, Simplex& simplex, span<double> best) {
+		const size_t n = start.size();
+		span<Vertex> vertices = simplex.vertices;
+
+		copy(start.begin(), start.end(), vertices[0].point.begin());
+		for (size_t i = 0; i < n; i++) {
+			span<double> corner = vertices[i + 1].point;
+			copy(start.begin(), start.end(), corner.begin());
+			corner[i] += corner[i] + size <= 1.0 ? size : -size;
+		}
+		for (auto& vertex : vertices) vertex.mass = f(vertex.point);
+		budget -= n + 1;
+
+		while (budget > 0) {
+			sort(vertices.begin(), vertices.end(), [](const Vertex& a, const Vertex& b) { return a.mass < b.mass; });
+
+			double diameter = 0.0;
+			for (const auto& vertex : vertices)
+				for (size_t i = 0; i < n; i++) diameter = max(diameter, abs(vertex.point[i] - vertices[0].point[i]));
+			if (diameter < 1e-5) break;
+
+			fill(simplex.centroid.begin(), simplex.centroid.end(), 0.0);
+			for (size_t p = 0; p < n; p++)
+				for (size_t i = 0; i < n; i++) simplex.centroid[i] += vertices[p].point[i] / n;
+
+			// the worst vertex only ever takes values, its memory stays its own
+			Vertex& worst = vertices[n];
+			auto replace = [&](span<const double> point, double mass) {
+				copy(point.begin(), point.end(), worst.point.begin());
+				worst.mass = mass;
+			};
+
+			toward(simplex.centroid, worst.point, -1.0, simplex.reflected);
+			const double reflectedMass = f(simplex.reflected);
+			budget--;
+
+			if (reflectedMass < vertices[0].mass) {
+				toward(simplex.centroid, worst.point, -2.0, simplex.expanded);
+				const double expandedMass = f(simplex.expanded);
+				budget--;
+
+				if (expandedMass < reflectedMass) replace(simplex.expanded, expandedMass);
+				else replace(simplex.reflected, reflectedMass);
+			} else if (reflectedMass < vertices[n - 1].mass) {
+				replace(simplex.reflected, reflectedMass);
+			} else {
+				toward(simplex.centroid, worst.point, 0.5, simplex.contracted);
+				const double contractedMass = f(simplex.contracted);
+				budget--;
+
+				if (contractedMass < worst.mass) {
+					replace(simplex.contracted, contractedMass);
+				} else { // nothing better along that line, pull everything in around the best point
+					for (size_t p = 1; p <= n; p++) {
+						toward(vertices[0].point, vertices[p].point, 0.5, vertices[p].point);
+						vertices[p].mass = f(vertices[p].point);
+					}
+					budget -= n;
+				}
+			}
+		}
+
+		const Vertex& found = *min_element(vertices.begin(), vertices.end(), [](const Vertex& a, const Vertex& b) { return a.mass < b.mass; });
+		copy(found.point.begin(), found.point.end(), best.begin());
+
+		return found.mass;
+	}
+
+	// Golden section over [low, high], for the single split of a two stage rocket.
+	template<class F>
+	pair<double, double> goldenSection(F&& f, double low, double high, int budget) {
+		const double ratio = (sqrt(5.0) - 1.0) / 2.0;
+
+		double a = high - ratio * (high - low), b = low + ratio * (high - low);
+		double fa = f(a), fb = f(b);
+
+		for (budget -= 2; budget > 0 && high - low > 1e-7; budget--) {
+			if (fa <= fb) {
+				high = b;
+				b = a, fb = fa;
+				a = high - ratio * (high - low), fa = f(a);
+			} else {
+				low = a;
+				a = b, fa = fb;
+				b = low + ratio * (high - low), fb = f(b);
+			}
+		}
+
+		return fa <= fb ? make_pair(a, fa) : make_pair(b, fb);
+	}
+};
+
+// Searches the per stage delta-v splits directly instead of sweeping one fraction shared by every
+// stage boundary. Two stages only have the one split, so a coarse scan brackets it and golden
+// section closes in; more stages run Nelder-Mead from a few seeds at once, each restarted smaller
+// around its best point to get past the steps discrete engine counts leave in the mass. Every
+// seed gets at most `evaluations` rocket evaluations, and every point and simplex comes out of
+// the arena before the seeds start.
+size_t fillOptimizedSplit(const SolveContext& context, const MultiArgs& args, int evaluations, span<StagePick> rocket) {
+	const int dims = args.stageCount - 1;
+	if (dims < 0) return 0;
+
+	Progress* progress = context.progress;
+
+	SolveArena ownArena;
+	SolveArena& arena = context.arena ? *context.arena : ownArena;
+	arena.reset();
+
+	auto massAt = [&](span<const double> splits) {
+		if (progress && progress->cancelled) return __DBL_MAX__;
+
+		thread_local vector<StagePick> trial; // one per seed's thread, every evaluation reuses it
+		trial.resize(args.stageCount);
+
+		const size_t filled = fillSplitMulti(context, args, splits, trial);
+		if (progress) {
+			context.offer(span(trial).first(filled));
+			progress->done++;
+		}
+
+		return filled == trial.size() && trial.back().feasible() ? trial.back().mass : __DBL_MAX__;
+	};
+
+	auto answer = [&](span<const double> splits) -> size_t {
+		const size_t filled = fillSplitMulti(context, args, splits, rocket);
+		return filled == rocket.size() && rocket.back().feasible() ? filled : 0;
+	};
+
+	if (dims == 0) return answer({});
+
+	if (dims == 1) {
+		if (progress) progress->total = evaluations;
+
+		// the steps can leave more than one valley, so narrow down the best two the scan finds
+		struct Sample {
+			double mass, split;
+			bool operator<(const Sample& other) const { return tie(mass, split) < tie(other.mass, other.split); }
+		};
+		const int scan = max(evaluations / 2, 4);
+		span<Sample> scanned = arena.take<Sample>(scan);
+		for (int i = 0; i < scan; i++) {
+			const double split = (i + 0.5) / scan;
+			scanned[i] = { massAt(span(&split, 1)), split };
+		}
+		partial_sort(scanned.begin(), scanned.begin() + 2, scanned.end());
+
+		Sample best = scanned[0];
+		for (int i = 0; i < 2; i++) {
+			const double split = scanned[i].split;
+			const auto [found, mass] = goldenSection([&](double x) { return massAt(span(&x, 1)); },
+				max(split - 1.0 / scan, 0.0), min(split + 1.0 / scan, 1.0), (evaluations - scan) / 2);
+
+			best = min(best, Sample{ mass, found });
+		}
+
+		return answer(span(&best.split, 1));
+	}
+
+	// equal delta-v for every stage, then the shared fractions the old sweep would land near
+	constexpr double fractions[] = { 0.3, 0.5, 0.7 };
+	const size_t seeds = 1 + size(fractions);
+
+	span<double> points = arena.take<double>(seeds * dims); // each seed's start, then its best
+	for (int k = 0; k < dims; k++) points[k] = 1.0 / (args.stageCount - k);
+	for (size_t i = 1; i < seeds; i++) fill_n(points.begin() + i * dims, dims, fractions[i - 1]);
+
+	span<double> masses = arena.take<double>(seeds);
+	span<Simplex> simplices = arena.take<Simplex>(seeds);
+	for (auto& simplex : simplices) simplex = Simplex(arena, dims);
+
+	if (progress) progress->total = seeds * evaluations;
+
+	parallelFor(seeds, context.threads, [&](size_t i, int) {
+		const span<double> point = points.subspan(i * dims, dims);
+		nelderMead(massAt, point, 0.2, evaluations / 2, simplices[i], point);
+		masses[i] = nelderMead(massAt, point, 0.05, evaluations - evaluations / 2, simplices[i], point);
+	}, 1);
+
+	// stable min, so ties go to the earliest seed whatever order the threads finished in
+	const size_t best = min_element(masses.begin(), masses.end()) - masses.begin();
+
+	return masses[best] < __DBL_MAX__ ? answer(points.subspan(best * dims, dims)) : 0;
+}
+
+vector<Stage> optimizeSplitMulti(const SolveContext& context, const MultiArgs& args, int evaluations) {
+	vector<StagePick> rocket(max(args.stageCount, 0));
+	if (fillOptimizedSplit(context, args, evaluations, rocket) == 0) return {};
+
+	return context.rocket(rocket);
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "ksp.hpp"
+#include "enginefile.hpp"
+#include "catalog.hpp"
+#include "cache.hpp"
+#include "tanks.hpp"
+
+using namespace std;
+
+namespace KSP {
+	// The engine catalog stored column by column, so the stage search streams
+	// straight through contiguous doubles instead of hopping over names. Rows are
+	// sorted by engine mass, which is what the stage search bounds are built on. The columns
+	// are views: into `storage`, which copies of the table share, or into a StaticEngineTable
+	// the compiler already filled in.
+	struct EngineTable {
+		span<const string_view> names;
+
+		span<const double> mass;
+
+		span<const double> vacIsp;
+		span<const double> atmIsp;
+
+		span<const double> vacThrust;
+		span<const double> atmThrust;
+
+		span<const double> tankRatio; // tank dry mass per tonne of fuel this engine burns
+
+		// best case over the whole table, for bounding what any engine could do
+		double bestVacIsp = 0.0;
+		double bestAtmIsp = 0.0;
+		double lightestTankRatio = __DBL_MAX__;
+
+		EngineTable() = default;
+		// Both also add the Nerv, which runs on its own tanks. `tankRatio` is what every other engine's
+		// tanks weigh per tonne of fuel, PartCatalog::tankRatio() for the real tanks.
+		EngineTable(const vector<Engine>& engines, double tankRatio = fuelRatio);
+		EngineTable(shared_ptr<const EngineFile> file, double tankRatio = fuelRatio); // names left in the mapping
+
+		// no copies and no heap, the table has to outlive every EngineTable made from it
+		template<size_t N>
+		EngineTable(const StaticEngineTable<N>& table) :
+			names(table.names), mass(table.mass), vacIsp(table.vacIsp), atmIsp(table.atmIsp),
+			vacThrust(table.vacThrust), atmThrust(table.atmThrust), tankRatio(table.tankRatio),
+			bestVacIsp(table.bestVacIsp), bestAtmIsp(table.bestAtmIsp), lightestTankRatio(table.lightestTankRatio) {}
+
+		size_t size() const { return mass.size(); }
+
+		Engine operator[](size_t i) const;
+		Stage stage(const StagePick& pick, const TankSolver* tanks = nullptr) const; // tanks rebuilt from `tanks` when given
+
+	private:
+		shared_ptr<const void> storage;
+
+		void build(vector<StaticEngine> rows, shared_ptr<const void> nameStorage); // adds the Nerv, sorts, fills the columns
+	};
+
+	// Shared between a running solve and whoever is watching it. The solver counts finished
+	// work into `done`, hands over every lighter rocket it finds, and bails out soon after
+	// `cancelled` is set.
+	struct Progress {
+		atomic<bool> cancelled = false;
+		atomic<size_t> done = 0;
+		atomic<size_t> total = 0;
+
+		atomic<size_t> candidates = 0; // engines looked at by stage searches
+		atomic<size_t> pruned = 0; // of those, how many were ruled out by bounds alone
+
+		void offer(const vector<Stage>& rocket); // kept only if lighter than the current best
+		void set(vector<Stage> rocket);
+		vector<Stage> best() const;
+		double lightest() const { return bestMass; } // the best's mass, without taking the lock
+
+		// trade-off solves report every rocket worth considering, not just the lightest
+		void setFront(vector<vector<Stage>> rockets);
+		vector<vector<Stage>> front() const;
+
+	private:
+		mutable mutex lock;
+		vector<Stage> bestRocket;
+		vector<vector<Stage>> frontRockets;
+
+		atomic<double> bestMass = __DBL_MAX__;
+	};
+
+	// Scratch memory for the multi stage solvers: blocks handed out in pieces that all come back at
+	// once on reset(). A piece never moves once handed out, and reset() folds everything the last
+	// solve used into one block, so an arena kept between solves stops touching the heap after the
+	// first. Only for trivially copyable types, nothing handed out is ever destroyed.
+	class SolveArena {
+	public:
+		template<class T>
+		span<T> take(size_t count, const T& value = T()) {
+			static_assert(is_trivially_copyable_v<T> && alignof(T) <= alignof(max_align_t));
+
+			T* items = (T*)grab(count * sizeof(T), alignof(T));
+			fill_n(items, count, value);
+
+			return { items, count };
+		}
+
+		void reset();
+
+	private:
+		struct Block {
+			unique_ptr<byte[]> data;
+			size_t size;
+		};
+
+		void* grab(size_t bytes, size_t align);
+
+		vector<Block> blocks;
+		size_t used = 0; // of the last block
+	};
+
+	// Everything a multi stage solve runs with besides the mission itself.
+	struct SolveContext {
+		const EngineTable& engines;
+		int threads = 1;
+
+		Progress* progress = nullptr;
+		StageCache* cache = nullptr; // must belong to `engines`, and to `tanks` when there are some
+		const TankSolver* tanks = nullptr; // build stages from real tanks instead of continuous fuel
+		SolveArena* arena = nullptr; // scratch kept between solves, each solve makes its own without one
+
+		StagePick stage(const Args& args) const; // pickOptimalStage or pickDiscreteStage, through the cache when there is one
+		void stageOptions(const Args& args, vector<StagePick>& options) const; // pickStageOptions or pickDiscreteOptions, the same way
+
+		vector<Stage> rocket(span<const StagePick> picks) const;
+		void offer(span<const StagePick> picks) const; // to `progress`, only turned into Stages if it's the lightest yet
+	};
+};
+
+KSP::StagePick pickOptimalStage(const KSP::EngineTable& engines, KSP::Args args, size_t* pruned = nullptr);
+KSP::StagePick pickDiscreteStage(const KSP::EngineTable& engines, const KSP::TankSolver& tanks, KSP::Args args, size_t* pruned = nullptr);
+KSP::Stage findOptimalStage(const KSP::EngineTable& engines, const KSP::Args& args, size_t* pruned = nullptr);
+KSP::Stage findDiscreteStage(const KSP::EngineTable& engines, const KSP::TankSolver& tanks, const KSP::Args& args, size_t* pruned = nullptr);
+void pickStageOptions(const KSP::EngineTable& engines, KSP::Args args, vector<KSP::StagePick>& options);
+void pickDiscreteOptions(const KSP::EngineTable& engines, const KSP::TankSolver& tanks, KSP::Args args, vector<KSP::StagePick>& options);
+vector<KSP::Stage> findStageOptions(const KSP::EngineTable& engines, const KSP::Args& args);
+
+// Fills `rocket` (args.stageCount long) from the top stage down and returns how many stages it got
+// to, which is fewer when one of them can't fly. Never allocates with the cache warm or off.
+size_t fillSplitMulti(const KSP::SolveContext& context, const KSP::MultiArgs& args, span<const double> splits, span<KSP::StagePick> rocket);
+
+vector<KSP::Stage> findSplitMulti(const KSP::SolveContext& context, const KSP::MultiArgs& args, const vector<double>& splits);
+vector<KSP::Stage> findRandomMulti(const KSP::SolveContext& context, const KSP::MultiArgs& args, double frac);
+vector<KSP::Stage> sweepMulti(const KSP::SolveContext& context, const KSP::MultiArgs& args, int iterations);
+vector<KSP::Stage> findOptimalMulti(const KSP::SolveContext& context, const KSP::MultiArgs& args, int bins);
+vector<KSP::Stage> optimizeSplitMulti(const KSP::SolveContext& context, const KSP::MultiArgs& args, int evaluations = 60);
+
+// The same two searches filling `rocket` (args.stageCount long), returning args.stageCount or 0
+// when nothing flies or the solve was cancelled. Like fillSplitMulti they never allocate with an
+// arena kept between calls, one thread, and the cache warm or off.
+size_t fillOptimalMulti(const KSP::SolveContext& context, const KSP::MultiArgs& args, int bins, span<KSP::StagePick> rocket);
+size_t fillOptimizedSplit(const KSP::SolveContext& context, const KSP::MultiArgs& args, int evaluations, span<KSP::StagePick> rocket);
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <cmath>
+
+#include "tanks.hpp"
+
+using namespace std;
+using namespace KSP;
+
+namespace {
+	// mass ratios get their own, finer grid: R multiplies everything
+	constexpr double ratioStep = 1e-6;
+
+	// The knapsack runs over gain in whole units: 1kg, or coarser once the target would need more
+	// than maxUnits of them. Gains round down and the target rounds up, so whatever stack comes out
+	// really does cover the target.
+	constexpr double finestUnit = 1e-3;
+	constexpr size_t maxUnits = 1 << 12;
+}
+
+KSP::TankSolver::TankSolver(const vector<Tank>& parts, double quantum, size_t capacity)
+	: step(quantum), capacity(capacity) {
+	for (size_t i = 0; i < parts.size(); i++) {
+		if (!(parts[i].fuel() > 0.0 && parts[i].dryMass >= 0.0)) continue;
+
+		tanks.push_back(Part{ (int)i, parts[i].dryMass, parts[i].fuel() });
+		lightestRatio = min(lightestRatio, parts[i].ratio());
+	}
+}
+
+TankStack KSP::TankSolver::solve(double R, double fixedMass) const {
+	if (tanks.empty() || !(R >= 1.0) || !isfinite(R) || !(fixedMass >= 0.0)) return TankStack{};
+	if (step <= 0.0) return search(R, fixedMass);
+
+	const Key key{ (int64_t)ceil(R / ratioStep), (int64_t)ceil(fixedMass / step) };
+	{
+		lock_guard guard(lock);
+		if (auto found = memo.find(key); found != memo.end()) {
+			hitCount++;
+			return found->second;
+		}
+	}
+	missCount++;
+
+	const TankStack stack = search(key.R * ratioStep, key.fixedMass * step);
+
+	lock_guard guard(lock);
+	if (memo.size() >= capacity) memo.clear(); // sweeps move on, old corners of the grid rarely come back
+	memo.emplace(key, stack);
+
+	return stack;
+}
+
+TankStack KSP::TankSolver::search(double R, double fixedMass) const {
+	struct Item {
+		int index;
+		double gain; // how far one tank gets toward the target
+		double mass;
+	};
+
+	// a tank adds f - (R - 1) * d toward the target, so at high R the dry mass eats it all
+	vector<Item> items;
+	for (const auto& tank : tanks) {
+		const double gain = tank.fuel - (R - 1.0) * tank.dryMass;
+		if (gain > 0.0) items.push_back(Item{ tank.index, gain, tank.dryMass + tank.fuel });
+	}
+
+	// drop tanks some other one beats on both counts, and repeats of one already kept
+	stable_sort(items.begin(), items.end(), [](const Item& a, const Item& b) { return a.gain > b.gain || (a.gain == b.gain && a.mass < b.mass); });
+	vector<Item> kept;
+	for (const auto& item : items) {
+		const bool dominated = any_of(kept.begin(), kept.end(), [&](const Item& other) { return other.mass <= item.mass; });
+		if (!dominated) kept.push_back(item);
+	}
+
+	const double target = (R - 1.0) * fixedMass;
+	if (kept.empty()) return TankStack{};
+	if (target <= 0.0) return TankStack{ {}, 0.0, 0.0, true };
+
+	const double unit = max(finestUnit, target / maxUnits);
+	const size_t units = (size_t)ceil(target / unit);
+
+	vector<size_t> gains;
+	items.clear();
+	for (const auto& item : kept) {
+		const size_t gain = (size_t)floor(item.gain / unit);
+		if (gain == 0) continue; // too small to count at this resolution
+
+		gains.push_back(gain);
+		items.push_back(item);
+	}
+	if (items.empty()) return TankStack{};
+
+	// lightest[x] is the least mass that covers x units, pick[x] the tank that gets it there and
+	// parts[x] how many tanks that takes. Stock tanks all hold fuel 8:1, so equal masses are
+	// everywhere and the stack with fewer parts wins those.
+	thread_local vector<double> lightest;
+	thread_local vector<int> pick, parts;
+	lightest.assign(units + 1, __DBL_MAX__);
+	pick.assign(units + 1, -1);
+	parts.assign(units + 1, 0);
+	lightest[0] = 0.0;
+
+	for (size_t x = 1; x <= units; x++) {
+		for (size_t i = 0; i < items.size(); i++) {
+			const size_t rest = x > gains[i] ? x - gains[i] : 0;
+			const double mass = items[i].mass + lightest[rest];
+			const double tie = 1e-9 * mass;
+
+			if (mass < lightest[x] - tie || (mass <= lightest[x] + tie && parts[rest] + 1 < parts[x])) {
+				lightest[x] = mass;
+				pick[x] = (int)i;
+				parts[x] = parts[rest] + 1;
+			}
+		}
+	}
+
+	vector<int> counts(items.size(), 0);
+	for (size_t x = units; x > 0;) {
+		const int i = pick[x];
+		counts[i]++;
+		x = x > gains[i] ? x - gains[i] : 0;
+	}
+
+	TankStack stack;
+	stack.feasible = true;
+	for (size_t i = 0; i < items.size(); i++) {
+		if (counts[i] == 0) continue;
+
+		const Part& part = *find_if(tanks.begin(), tanks.end(), [&](const Part& p) { return p.index == items[i].index; });
+		stack.tanks.emplace_back(items[i].index, counts[i]);
+		stack.dryMass += counts[i] * part.dryMass;
+		stack.fuel += counts[i] * part.fuel;
+	}
+
+	return stack;
+}
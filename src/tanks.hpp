@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "parts.hpp"
+
+using namespace std;
+
+namespace KSP {
+	struct TankStack {
+		vector<pair<int, int>> tanks; // (index into the tank list, how many)
+
+		double dryMass = 0.0;
+		double fuel = 0.0;
+
+		bool feasible = false;
+
+		double mass() const { return dryMass + fuel; }
+	};
+
+	// Picks the lightest stack of real tanks that gets a fixed mass (payload, engines, decoupler)
+	// through a mass ratio R. With tank i holding fuel f_i on dry mass d_i, a stack works when
+	// sum(f_i - (R - 1) * d_i) >= (R - 1) * fixed, so it's a covering knapsack: reach that
+	// target at the least sum(d_i + f_i). Tanks another one beats outright are dropped, then an
+	// unbounded knapsack DP solves it exactly over gain counted in small whole units.
+	//
+	// Answers are memoized with R and the fixed mass snapped up to a grid, which only ever asks
+	// for more fuel than needed, so a remembered stack is always buildable. Thread safe.
+	class TankSolver {
+	public:
+		TankSolver(const vector<Tank>& tanks, double quantum = 1e-3, size_t capacity = 1 << 16);
+
+		TankStack solve(double R, double fixedMass) const; // not feasible if no stack gets there
+
+		bool empty() const { return tanks.empty(); }
+		double ratio() const { return lightestRatio; } // best dry mass per tonne of fuel of any tank
+		size_t hits() const { return hitCount; }
+		size_t misses() const { return missCount; }
+
+	private:
+		struct Part {
+			int index;
+			double dryMass, fuel;
+		};
+
+		struct Key {
+			int64_t R, fixedMass;
+
+			bool operator==(const Key&) const = default;
+		};
+
+		struct KeyHash {
+			size_t operator()(const Key& key) const { return (size_t)(key.R * 0x9e3779b97f4a7c15 ^ key.fixedMass); }
+		};
+
+		TankStack search(double R, double fixedMass) const;
+
+		vector<Part> tanks;
+		double lightestRatio = __DBL_MAX__;
+		const double step;
+		const size_t capacity;
+
+		mutable mutex lock;
+		mutable unordered_map<Key, TankStack, KeyHash> memo;
+
+		mutable atomic<size_t> hitCount = 0;
+		mutable atomic<size_t> missCount = 0;
+	};
+};